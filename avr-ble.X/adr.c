@@ -0,0 +1,145 @@
+#include "clock.h"
+
+#include "adr.h"
+#include "lora.h"
+#include "proto.h"
+#include "toa.h"
+
+static uint8_t rate;
+static uint8_t power;
+static uint8_t channel;
+static int16_t margin; // quarter dB
+static uint8_t samples; // answered heartbeats since the last change
+static uint8_t misses; // unanswered heartbeats in a row
+static uint8_t complete; // heartbeats in a row every pad polled answered
+
+void adr_init() {
+    rate = PROTO_RATE_DEFAULT;
+    power = PROTO_POWER_MAX;
+    channel = PROTO_CHANNEL_HOME;
+    margin = 0;
+    samples = 0;
+    misses = 0;
+    complete = 0;
+    lora_set_preamble_length(proto_wake_preamble(rate));
+    lora_set_freq(proto_channel_hz(channel));
+    lora_apply_config();
+}
+
+void adr_heartbeat(int8_t signal, int16_t rssi, int8_t snr) {
+    int8_t local = proto_signal(rssi, snr);
+    int16_t weakest = signal < local ? signal : local;
+    int16_t sample = (weakest - proto_rate_sensitivity(rate)) * 4;
+    if (samples == 0) {
+        margin = sample;
+    } else {
+        margin += (sample - margin) / ADR_SMOOTHING;
+    }
+    if (samples < 0xFF) samples++;
+    if (complete < 0xFF) complete++;
+    misses = 0;
+}
+
+void adr_partial() {
+    complete = 0;
+}
+
+uint8_t adr_miss() {
+    complete = 0;
+    if (misses < 0xFF) misses++;
+    if (misses < ADR_FALLBACK_MISSES) return 0;
+    return adr_lost();
+}
+
+uint8_t adr_lost() {
+    if (rate == PROTO_RATE_ROBUST && power == PROTO_POWER_MAX && channel == PROTO_CHANNEL_HOME) return 0;
+    return adr_apply(PROTO_RATE_ROBUST, PROTO_POWER_MAX, PROTO_CHANNEL_HOME) == ECODE_OK;
+}
+
+uint8_t adr_propose(uint8_t *new_rate, uint8_t *new_power) {
+    if (samples < ADR_SETTLE) return 0;
+    int8_t db = adr_margin();
+    *new_rate = rate;
+    *new_power = power;
+    if (db >= ADR_MARGIN_UP) {
+        if (complete < ADR_SETTLE) return 0;
+        if (rate + 1 < PROTO_RATE_COUNT) {
+            *new_rate = rate + 1;
+        } else if (power > PROTO_POWER_MIN) {
+            *new_power = power - ADR_POWER_STEP < PROTO_POWER_MIN ? PROTO_POWER_MIN : power - ADR_POWER_STEP;
+        } else {
+            return 0;
+        }
+    } else if (db < ADR_MARGIN_DOWN) {
+        if (power < PROTO_POWER_MAX) {
+            *new_power = power + ADR_POWER_STEP > PROTO_POWER_MAX ? PROTO_POWER_MAX : power + ADR_POWER_STEP;
+        } else if (rate > PROTO_RATE_ROBUST) {
+            *new_rate = rate - 1;
+        } else {
+            return 0;
+        }
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+static uint8_t bandwidth_code(uint32_t hz) {
+    if (hz >= 500000) return BANDWIDTH_500_KHZ;
+    if (hz >= 250000) return BANDWIDTH_250_KHZ;
+    return BANDWIDTH_125_KHZ;
+}
+
+ECODE adr_apply(uint8_t new_rate, uint8_t new_power, uint8_t new_channel) {
+    if (new_rate >= PROTO_RATE_COUNT || new_channel >= PROTO_CHANNEL_COUNT || lora_tx_busy()) return ECODE_FAIL;
+    /* carry the margin over to the new setting until it has been measured */
+    margin += ((proto_rate_sensitivity(rate) - proto_rate_sensitivity(new_rate)) + (new_power - power)) * 4;
+    rate = new_rate;
+    power = new_power;
+    channel = new_channel;
+    samples = 0;
+    misses = 0;
+    complete = 0;
+    /* change modem settings in standby, not while receiving */
+    lora_standby();
+    lora_set_spreading_factor(proto_rate_sf(rate));
+    lora_set_bandwidth(bandwidth_code(proto_rate_bw_hz(rate)));
+    lora_tx_power(power);
+    lora_set_preamble_length(proto_wake_preamble(rate));
+    lora_set_freq(proto_channel_hz(channel));
+    lora_apply_config();
+    lora_rx_continuous();
+    return ECODE_OK;
+}
+
+uint16_t adr_poll_ms(uint16_t preamble, uint8_t answers) {
+    toa_config_t config;
+    toa_default_config(&config);
+    config.sf = proto_rate_sf(rate);
+    config.bandwidth = bandwidth_code(proto_rate_bw_hz(rate));
+    config.preamble = preamble;
+    /* RATE is the longest command, the answers come in their slots */
+    uint32_t ping_us = toa_packet_us(&config, PROTO_HEADER_LEN + proto_body_len(PROTO_OP_RATE));
+    uint32_t ms = (ping_us + answers * proto_slot_us(rate)) / 1000;
+    uint32_t duty_ms = ping_us / (10 * PROTO_POLL_DUTY_PERCENT);
+    if (duty_ms > ms) ms = duty_ms;
+    if (ms < PROTO_POLL_MIN_MS) ms = PROTO_POLL_MIN_MS;
+    if (ms > PROTO_HEARTBEAT_MS) ms = PROTO_HEARTBEAT_MS;
+    return ms;
+}
+
+uint8_t adr_rate() {
+    return rate;
+}
+
+uint8_t adr_power() {
+    return power;
+}
+
+uint8_t adr_channel() {
+    return channel;
+}
+
+int8_t adr_margin() {
+    return margin / 4;
+}
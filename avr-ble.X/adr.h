@@ -0,0 +1,73 @@
+#ifndef __ADR_H_
+#define __ADR_H_
+
+#include "ecode.h"
+
+/*
+Link adaptation (adaptive data rate and TX power)
+
+Each answered heartbeat gives a link margin: the weaker of the two
+directions (the strength the receiver reports in STATUS, and the STATUS
+itself as heard here) above the sensitivity of the current rate. The
+margin is smoothed over ADR_SMOOTHING heartbeats.
+
+With margin to spare the link first moves to a faster rate, for the
+shortest time on air, and at the fastest rate lowers the TX power. Short
+of margin it raises the power first and slows down once at full power.
+After every change it waits ADR_SETTLE heartbeats before deciding again.
+The controller proposes changes to the receiver with PROTO_OP_RATE (see
+proto.h) and applies them with adr_apply() when the receiver has answered.
+
+The setting also holds the channel, which chan.h picks; it changes with
+the same RATE. ADR_FALLBACK_MISSES unanswered heartbeats in a row put the
+radio on PROTO_RATE_ROBUST at full power on PROTO_CHANNEL_HOME, where the
+receiver also ends up when it stops hearing the controller. With several
+pads the margin is the weakest pad's, and one pad lost (pad.h) is enough
+to go there and look for it. A pad that misses a RATE is left behind on
+the old setting, so the link only speeds up or lowers the power after
+ADR_SETTLE heartbeats in a row that every pad polled answered.
+*/
+
+// Margin in dB above which the link speeds up or lowers the power
+#define ADR_MARGIN_UP           12
+// Margin in dB below which the link raises the power or slows down
+#define ADR_MARGIN_DOWN         6
+#define ADR_POWER_STEP          3
+#define ADR_SMOOTHING           4
+#define ADR_SETTLE              4
+#define ADR_FALLBACK_MISSES     3
+
+// Start at PROTO_RATE_DEFAULT and full power on PROTO_CHANNEL_HOME, as lora_init() leaves
+// the radio, with the preamble that wakes the receiver (proto_wake_preamble())
+void adr_init();
+
+// A heartbeat was answered: 'signal' from the STATUS body, RSSI and SNR of the STATUS packet
+void adr_heartbeat(int8_t signal, int16_t rssi, int8_t snr);
+
+// A heartbeat was answered by some of the pads it polled, not all. Call after adr_heartbeat()
+void adr_partial();
+
+// A heartbeat went unanswered. Returns 1 if the radio fell back to the robust rate
+uint8_t adr_miss();
+
+// A pad stopped answering while others still do. Returns 1 if the radio fell back to the robust rate
+uint8_t adr_lost();
+
+// Setting to propose to the receiver, if the margin calls for one. Returns 1 and fills 'rate' and 'power'
+uint8_t adr_propose(uint8_t *rate, uint8_t *power);
+
+// Program the radio with a data rate, its wake preamble, TX power and channel. Fails while a packet is on air
+ECODE adr_apply(uint8_t rate, uint8_t power, uint8_t channel);
+
+// Heartbeat period for fast poll at the current rate, ms: a ping with 'preamble' symbols and
+// 'answers' answer slots fit, the ping takes at most PROTO_POLL_DUTY_PERCENT of the air time,
+// and never shorter than PROTO_POLL_MIN_MS or longer than PROTO_HEARTBEAT_MS
+uint16_t adr_poll_ms(uint16_t preamble, uint8_t answers);
+
+uint8_t adr_rate();
+uint8_t adr_power();
+uint8_t adr_channel();
+// Smoothed link margin in dB
+int8_t adr_margin();
+
+#endif /* __ADR_H_ */
@@ -0,0 +1,113 @@
+#include "clock.h"
+
+#include "afc.h"
+#include "chan.h"
+#include "lora.h"
+#include "proto.h"
+#include "tca.h"
+
+static int32_t estimate[PROTO_PAD_MAX]; // Hz above the nominal frequency
+static uint8_t heard; // pads with an estimate, a mask as in proto.h
+static uint16_t retunes;
+static uint16_t undone;
+static int32_t residual; // how far packets come in off the radio's frequency, smoothed over all pads
+/* the last retune on trial: the correction before it and the residual then, the packets
+   received since and their summed error */
+static uint8_t checking;
+static uint32_t retunedAt; // tca_micros() once the radio was back in receive
+static uint32_t retunedMs; // and tca_millis()
+static uint8_t checked;
+static int32_t before;
+static int32_t residualBefore;
+static int32_t sumAfter;
+/* after an undo no retune until holdMs have passed since heldAt, doubling with each undo in a row */
+static uint32_t heldAt;
+static uint32_t holdMs;
+
+static int32_t magnitude(int32_t hz) {
+    return hz < 0 ? -hz : hz;
+}
+
+void afc_init() {
+    heard = 0;
+    retunes = 0;
+    undone = 0;
+    checking = 0;
+    holdMs = 0;
+    lora_set_freq_correction(0);
+}
+
+void afc_packet(uint8_t id, int32_t freq_error, uint32_t at) {
+    if (id < 1 || id > PROTO_PAD_MAX) return;
+    uint8_t bit = proto_pad_bit(id);
+    int32_t *e = &estimate[id - 1];
+    /* one received before the retune came in on the old frequency, it says nothing about the new
+       one; its error above the nominal frequency still counts for the estimate */
+    uint8_t stale = checking && tca_micros_since(at) >= tca_micros_since(retunedAt);
+    if (!stale) {
+        int32_t off = magnitude(freq_error - lora_freq_correction());
+        residual = heard ? residual + (off - residual) / AFC_SMOOTHING : off;
+        if (checking && checked < AFC_SMOOTHING) {
+            sumAfter += off;
+            checked++;
+        }
+    }
+    if (!(heard & bit)) {
+        *e = freq_error;
+        heard |= bit;
+    } else {
+        *e += (freq_error - *e) / AFC_SMOOTHING;
+    }
+}
+
+void afc_task() {
+    if (!heard || lora_tx_busy()) return;
+    /* judge the last retune on the mean error of the packets since: further off than packets
+       came in before it, the error indication is read the wrong way round (lora.c). Nothing heard
+       in AFC_CHECK_MS, it may have tuned away from them. Go back, and leave it for a while */
+    if (checking) {
+        if (checked < AFC_SMOOTHING && tca_millis_since(retunedMs) < AFC_CHECK_MS) return;
+        checking = 0;
+        if (!checked || sumAfter / checked > residualBefore + AFC_DEADBAND_HZ) {
+            lora_set_freq_correction(before);
+            chan_retune();
+            undone++;
+            heldAt = tca_millis();
+            holdMs = holdMs ? (holdMs < AFC_HOLD_MAX_MS / 2 ? 2 * holdMs : AFC_HOLD_MAX_MS) : AFC_HOLD_MS;
+            return;
+        }
+        holdMs = 0;
+    }
+    if (holdMs && tca_millis_since(heldAt) < holdMs) return;
+    int32_t low = 0, high = 0;
+    uint8_t first = 1;
+    for (uint8_t i = 0; i < PROTO_PAD_MAX; i++) {
+        if (!(heard & proto_pad_bit(i + 1))) continue;
+        if (first || estimate[i] < low) low = estimate[i];
+        if (first || estimate[i] > high) high = estimate[i];
+        first = 0;
+    }
+    int32_t target = low + (high - low) / 2;
+    if (target > AFC_MAX_HZ) target = AFC_MAX_HZ;
+    if (target < -AFC_MAX_HZ) target = -AFC_MAX_HZ;
+    int32_t change = target - lora_freq_correction();
+    if (change < AFC_DEADBAND_HZ && change > -AFC_DEADBAND_HZ) return;
+    before = lora_freq_correction();
+    residualBefore = residual;
+    lora_set_freq_correction(target);
+    chan_retune();
+    retunedAt = tca_micros();
+    retunedMs = tca_millis();
+    checking = 1;
+    checked = 0;
+    sumAfter = 0;
+    retunes++;
+}
+
+uint16_t afc_retunes() {
+    return retunes;
+}
+
+uint16_t afc_undone() {
+    return undone;
+}
@@ -0,0 +1,57 @@
+#ifndef __AFC_H_
+#define __AFC_H_
+
+#include <stdint.h>
+
+#include "proto.h"
+
+/*
+Automatic frequency correction
+
+The radios' carriers are only as close as their 32 MHz crystals, 20 ppm
+each is 9 kHz at 433 MHz, and cheap ones move further in the cold. The
+radio measures how far off every packet it receives is (lora_packet_t
+freq_error). afc_packet() smooths that into an estimate per pad over
+AFC_SMOOTHING packets. afc_task() trims the controller's radio to the
+middle of the pads it has heard, which leaves the worst of them as close
+as it can be. It does so once the estimate is AFC_DEADBAND_HZ away from
+the correction in use, and never beyond AFC_MAX_HZ: two crystals at their
+limit and some cold on top. The correction carries across channels
+(lora_set_freq_correction()).
+
+Only the controller trims, so the two ends never chase each other.
+
+Which way round the radio reports the error has only been checked against
+the sim's model (lora.c). So every retune is judged on the mean error of
+the next AFC_SMOOTHING packets received after it: if they are further off
+the radio's frequency than the pads were before it by more than
+AFC_DEADBAND_HZ, or if fewer came within AFC_CHECK_MS and those are, or
+none came at all, afc_task() puts the correction back. It tries again after
+AFC_HOLD_MS, twice that after another undo in a row and so on up to
+AFC_HOLD_MAX_MS. A wrong sign leaves the link about as it would be without
+correction.
+*/
+
+#define AFC_SMOOTHING       4
+#define AFC_DEADBAND_HZ     500
+#define AFC_MAX_HZ          25000
+#define AFC_CHECK_MS        (2UL * AFC_SMOOTHING * PROTO_HEARTBEAT_MS)
+#define AFC_HOLD_MS         10000UL
+#define AFC_HOLD_MAX_MS     160000UL
+
+// Nothing heard, no correction
+void afc_init();
+
+// A packet from pad 'id' came in 'freq_error' Hz above the nominal frequency, RxDone at tca_micros() 'at'
+void afc_packet(uint8_t id, int32_t freq_error, uint32_t at);
+
+// Retune if the estimate has moved. Call while none of the link's own packets are on air or due
+void afc_task();
+
+// Times the correction was changed since power-up
+uint16_t afc_retunes();
+
+// Retunes that made the error grow and were undone
+uint16_t afc_undone();
+
+#endif /* __AFC_H_ */
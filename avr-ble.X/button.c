@@ -0,0 +1,73 @@
+#include "clock.h"
+
+#include "button.h"
+#include "tca.h"
+
+typedef struct {
+    volatile uint8_t pressed;
+    volatile uint32_t pressed_at; // tca_micros() of the press
+    volatile uint32_t edge_at; // tca_micros() of the last edge
+} button_t;
+
+static button_t buttons[BUTTON_COUNT];
+
+// Press/release callback function pointer
+static void (*button_callback)(uint8_t button, uint8_t pressed);
+
+static void button_set(uint8_t button, uint8_t pressed, uint32_t now) {
+    buttons[button].pressed = pressed;
+    if (pressed) buttons[button].pressed_at = now;
+    if (button_callback) button_callback(button, pressed);
+}
+
+void button_edge_isr(uint8_t button) {
+    uint32_t now = tca_micros();
+    buttons[button].edge_at = now;
+    /* the first edge of a press counts, the bounce after it does not */
+    if (!buttons[button].pressed && hal_button_down(button)) {
+        button_set(button, 1, now);
+    }
+}
+
+ECODE button_init() {
+    hal_button_init();
+    uint32_t now = tca_micros();
+    for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+        buttons[i].edge_at = now;
+        buttons[i].pressed = hal_button_down(i);
+        buttons[i].pressed_at = now;
+    }
+    return ECODE_OK;
+}
+
+void button_update() {
+    for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+        uint8_t sreg = hal_irq_save();
+        uint32_t now = tca_micros();
+        uint8_t down = hal_button_down(i);
+        if (buttons[i].pressed && !down && now - buttons[i].edge_at >= BUTTON_DEBOUNCE_MS * 1000UL) {
+            button_set(i, 0, now);
+        } else if (!buttons[i].pressed && down) {
+            /* the edge interrupt caught a bounce up, the button is down since */
+            button_set(i, 1, now);
+        }
+        hal_irq_restore(sreg);
+    }
+}
+
+uint8_t button_pressed(uint8_t button) {
+    if (button >= BUTTON_COUNT) return 0;
+    return buttons[button].pressed;
+}
+
+uint32_t button_held_ms(uint8_t button) {
+    if (button >= BUTTON_COUNT) return 0;
+    uint8_t sreg = hal_irq_save();
+    uint32_t held = buttons[button].pressed ? (tca_micros() - buttons[button].pressed_at) / 1000 : 0;
+    hal_irq_restore(sreg);
+    return held;
+}
+
+void register_button_callback(void (*callback)(uint8_t button, uint8_t pressed)) {
+    button_callback = callback;
+}
@@ -0,0 +1,46 @@
+#ifndef __BUTTON_H_
+#define __BUTTON_H_
+
+#include "hal.h"
+
+/*
+ARM and IGNITE buttons
+
+Every edge raises a pin change interrupt (hal_button_init()) and is
+stamped with tca_micros(). A press counts at its first edge, so IGNITE is
+seen at once; the contacts may bounce after that, and a release only
+counts once the button has stayed up for BUTTON_DEBOUNCE_MS since the last
+edge. How long a button has been held follows from the press time, not
+from how often the main loop polled it, so a busy loop cannot stretch it.
+*/
+
+/* ARM_BUTTON_PIN - PC1 */
+#define ARM_BUTTON_PIN        PIN1_bm
+/* IGNITE_BUTTON_PIN - PD6 */
+#define IGNITE_BUTTON_PIN     PIN6_bm
+
+#define BUTTON_ARM            0
+#define BUTTON_IGNITE         1
+#define BUTTON_COUNT          2
+
+// Contact bounce has settled this long after the last edge
+#define BUTTON_DEBOUNCE_MS    10
+
+// Set up the pins and their interrupts, after tca_init()
+ECODE button_init();
+
+// Pick up releases and any press whose edge was missed. Call every millisecond
+void button_update();
+
+uint8_t button_pressed(uint8_t button);
+
+// How long 'button' has been held down, 0 while it is up
+uint32_t button_held_ms(uint8_t button);
+
+// Register function to run when a button is pressed or released. Runs from the pin change interrupt
+void register_button_callback(void (*callback)(uint8_t button, uint8_t pressed));
+
+// Pin change handler, called from the HAL
+void button_edge_isr(uint8_t button);
+
+#endif /* __BUTTON_H_ */
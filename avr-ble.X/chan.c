@@ -0,0 +1,172 @@
+#include "clock.h"
+
+#include "chan.h"
+#include "adr.h"
+#include "lora.h"
+#include "proto.h"
+#include "tca.h"
+
+static uint8_t busy[PROTO_CHANNEL_COUNT]; // occupancy, percent
+static uint8_t measured[PROTO_CHANNEL_COUNT];
+static uint8_t working; // adr_channel() the window below belongs to
+static uint8_t samples; // readings in the working channel's window
+static uint8_t hits; // of them busy
+static uint8_t tuned; // channel the radio is on
+static uint32_t tunedAt;
+static uint8_t scanning; // the working channel is busy, look at the others
+static uint8_t away; // looking at 'tuned', not the working channel
+static uint8_t looked; // the last channel looked at
+static uint8_t awaySamples;
+static uint8_t awayHits;
+static uint8_t waiting; // chan_clear() found the channel busy at waitSince
+static uint32_t waitSince;
+static uint16_t held;
+static uint16_t forced;
+
+static void tune(uint8_t channel) {
+    lora_standby();
+    lora_set_freq(proto_channel_hz(channel));
+    lora_apply_config();
+    lora_rx_continuous();
+    tuned = channel;
+    tunedAt = tca_millis();
+}
+
+static uint8_t reading_busy() {
+    return proto_channel_busy(adr_rate(), lora_rssi(proto_channel_hz(tuned)));
+}
+
+static void record(uint8_t channel, uint8_t percent) {
+    if (!measured[channel]) {
+        busy[channel] = percent;
+        measured[channel] = 1;
+    } else {
+        busy[channel] += ((int16_t) percent - busy[channel]) / CHAN_SMOOTHING;
+    }
+}
+
+void chan_init() {
+    for (uint8_t ch = 0; ch < PROTO_CHANNEL_COUNT; ch++) {
+        busy[ch] = 0;
+        measured[ch] = 0;
+    }
+    working = tuned = looked = adr_channel();
+    tunedAt = tca_millis();
+    samples = hits = 0;
+    scanning = away = waiting = 0;
+    held = forced = 0;
+}
+
+void chan_survey() {
+    /* the tick is not running yet, count the milliseconds here */
+    for (uint8_t ch = 0; ch < PROTO_CHANNEL_COUNT; ch++) {
+        tune(ch);
+        hal_delay_ms(CHAN_SETTLE_MS);
+        uint16_t count = 0;
+        for (uint16_t ms = 0; ms < CHAN_SURVEY_MS; ms++) {
+            if (reading_busy()) count++;
+            hal_delay_ms(1);
+        }
+        record(ch, count * 100UL / CHAN_SURVEY_MS);
+    }
+    tune(adr_channel());
+}
+
+void chan_return() {
+    if (!away || lora_tx_busy()) return;
+    away = 0;
+    tune(adr_channel());
+}
+
+void chan_retune() {
+    if (lora_tx_busy()) return;
+    tune(tuned);
+}
+
+void chan_task(uint8_t sample, uint8_t leave) {
+    if (lora_tx_busy()) return;
+    if (away) {
+        if (!leave) {
+            chan_return();
+            return;
+        }
+        if (tca_millis_since(tunedAt) >= CHAN_SETTLE_MS) {
+            awaySamples++;
+            if (reading_busy()) awayHits++;
+        }
+        if (tca_millis_since(tunedAt) >= CHAN_DWELL_MS) {
+            if (awaySamples) record(tuned, awayHits * 100 / awaySamples);
+            chan_return();
+        }
+        return;
+    }
+    /* a new working channel starts its own window */
+    if (adr_channel() != working) {
+        working = adr_channel();
+        samples = hits = 0;
+        scanning = 0;
+    }
+    if (sample && tca_millis_since(tunedAt) >= CHAN_SETTLE_MS) {
+        samples++;
+        if (reading_busy()) hits++;
+        if (samples == CHAN_WINDOW) {
+            record(working, hits * 100 / CHAN_WINDOW);
+            samples = hits = 0;
+            scanning = busy[working] >= CHAN_MOVE_PERCENT;
+        }
+    }
+    if (scanning && leave && PROTO_CHANNEL_COUNT > 1) {
+        /* the next one round from the last looked at */
+        do {
+            looked = (looked + 1) % PROTO_CHANNEL_COUNT;
+        } while (looked == working);
+        away = 1;
+        awaySamples = awayHits = 0;
+        tune(looked);
+    }
+}
+
+uint8_t chan_propose(uint8_t *channel) {
+    uint8_t current = adr_channel();
+    if (!measured[current]) return 0;
+    uint8_t best = current;
+    for (uint8_t ch = 0; ch < PROTO_CHANNEL_COUNT; ch++) {
+        if (measured[ch] && busy[ch] < busy[best]) best = ch;
+    }
+    if (best == current || busy[best] + CHAN_HYSTERESIS_PERCENT > busy[current]) return 0;
+    *channel = best;
+    return 1;
+}
+
+uint8_t chan_clear() {
+    /* the send fails anyway, and on air the RSSI reads nothing */
+    if (lora_tx_busy()) return 1;
+    chan_return();
+    if (tca_millis_since(tunedAt) < CHAN_SETTLE_MS) return 0;
+    if (!reading_busy()) {
+        waiting = 0;
+        return 1;
+    }
+    if (!waiting) {
+        waiting = 1;
+        waitSince = tca_millis();
+        held++;
+        return 0;
+    }
+    if (tca_millis_since(waitSince) < PROTO_LBT_MAX_MS) return 0;
+    waiting = 0;
+    forced++;
+    return 1;
+}
+
+uint8_t chan_busy(uint8_t channel) {
+    return measured[channel] ? busy[channel] : 0xFF;
+}
+
+uint16_t chan_held() {
+    return held;
+}
+
+uint16_t chan_forced() {
+    return forced;
+}
@@ -0,0 +1,70 @@
+#ifndef __CHAN_H_
+#define __CHAN_H_
+
+#include <stdint.h>
+
+/*
+Channel assessment and listen before talk
+
+The RSSI the radio reads in receive (lora_rssi()) shows whether someone
+else is on a channel. chan_task() reads it on the working channel
+(adr_channel()) while none of the link's own packets are on air or due,
+and every CHAN_WINDOW readings turns the share that were busy
+(proto_channel_busy()) into the channel's occupancy, smoothed over
+CHAN_SMOOTHING windows.
+
+At power-up chan_survey() listens on every channel for CHAN_SURVEY_MS.
+Once the working channel is CHAN_MOVE_PERCENT busy the controller looks
+at the others, one at a time for CHAN_DWELL_MS whenever the link can spare
+it. chan_propose() offers the quietest channel when it is
+CHAN_HYSTERESIS_PERCENT less busy than the working one; the pads move with
+RATE (proto.h) like a rate change, and adr_apply() moves the radio.
+
+chan_clear() is the check before every transmit: it comes back to the
+working channel if it was looking at another, and reads the RSSI. A busy
+channel holds the packet back for at most PROTO_LBT_MAX_MS.
+*/
+
+// Working channel readings: how often, and how many make a window
+#define CHAN_SAMPLE_MS              5
+#define CHAN_WINDOW                 100
+#define CHAN_SMOOTHING              2
+// Time spent on each channel at power-up, and on each look at another one later
+#define CHAN_SURVEY_MS              250
+#define CHAN_DWELL_MS               50
+// After retuning the RSSI needs this long to read the new channel
+#define CHAN_SETTLE_MS              1
+// Occupancy at which to look for another channel, and how much quieter that has to be
+#define CHAN_MOVE_PERCENT           20
+#define CHAN_HYSTERESIS_PERCENT     10
+
+// Start on the working channel with nothing measured
+void chan_init();
+
+// Measure every channel, blocking for PROTO_CHANNEL_COUNT * CHAN_SURVEY_MS. Call before the scheduler runs
+void chan_survey();
+
+// Every CHAN_SAMPLE_MS. 'sample': none of the link's own packets are on air or due, the reading is
+// someone else's. 'leave': nor will they be for CHAN_DWELL_MS, the radio may look at another channel
+void chan_task(uint8_t sample, uint8_t leave);
+
+// Back to the working channel, if looking at another one
+void chan_return();
+
+// Tune the channel the radio is on again, with a new lora_set_freq_correction(). Not while transmitting
+void chan_retune();
+
+// A quieter channel than the working one, if there is one. Returns 1 and fills 'channel'
+uint8_t chan_propose(uint8_t *channel);
+
+// Listen before talk: 1 if the working channel is clear, or has been busy for PROTO_LBT_MAX_MS.
+// Call right before sending, again until it returns 1
+uint8_t chan_clear();
+
+// Occupancy of a channel in percent, 0xFF if not measured yet
+uint8_t chan_busy(uint8_t channel);
+// Packets held back by a busy channel since power-up, and sent anyway after PROTO_LBT_MAX_MS
+uint16_t chan_held();
+uint16_t chan_forced();
+
+#endif /* __CHAN_H_ */
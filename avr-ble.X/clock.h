@@ -0,0 +1,108 @@
+#ifndef __CLOCK_H_
+#define __CLOCK_H_
+
+/*
+Clock configuration
+
+Include first in every source file: F_CPU is defined here and nowhere
+else, and <util/delay.h> needs it before it is included. The main clock
+prescaler is set from CLOCK_PRESCALER by hal_clock_init() at boot. The
+tick timer period, the SPI clock divider and the USART baud register are
+all derived from F_CPU below, and the build fails if one of them cannot be
+met exactly enough, or if F_CPU is above what the supply voltage allows.
+*/
+
+// Internal oscillator, FUSE.OSCCFG FREQSEL at its default 20 MHz
+#define CLOCK_OSC_HZ            20000000UL
+// Main clock prescaler: 1 (off), 2, 4, 6, 8, 10, 12, 16, 24, 32, 48 or 64. Reset default is 6
+#define CLOCK_PRESCALER         2
+// The board's supply, the radio's 3.3 V rail
+#define CLOCK_VDD_MV            3300
+
+#define F_CPU                   (CLOCK_OSC_HZ / CLOCK_PRESCALER)
+
+/* maximum frequency vs. VDD (datasheet, electrical characteristics): 5 MHz from 1.8 V,
+   10 MHz from 2.7 V, 20 MHz from 4.5 V */
+#if CLOCK_VDD_MV >= 4500
+#define CLOCK_MAX_HZ            20000000UL
+#elif CLOCK_VDD_MV >= 2700
+#define CLOCK_MAX_HZ            10000000UL
+#else
+#define CLOCK_MAX_HZ            5000000UL
+#endif
+
+#if F_CPU > CLOCK_MAX_HZ
+#error "F_CPU is above the maximum frequency at CLOCK_VDD_MV, raise CLOCK_PRESCALER"
+#endif
+
+#if CLOCK_PRESCALER == 1
+#define CLOCK_MCLKCTRLB         0
+#elif CLOCK_PRESCALER == 2
+#define CLOCK_MCLKCTRLB         (CLKCTRL_PDIV_2X_gc | CLKCTRL_PEN_bm)
+#elif CLOCK_PRESCALER == 4
+#define CLOCK_MCLKCTRLB         (CLKCTRL_PDIV_4X_gc | CLKCTRL_PEN_bm)
+#elif CLOCK_PRESCALER == 6
+#define CLOCK_MCLKCTRLB         (CLKCTRL_PDIV_6X_gc | CLKCTRL_PEN_bm)
+#elif CLOCK_PRESCALER == 8
+#define CLOCK_MCLKCTRLB         (CLKCTRL_PDIV_8X_gc | CLKCTRL_PEN_bm)
+#elif CLOCK_PRESCALER == 10
+#define CLOCK_MCLKCTRLB         (CLKCTRL_PDIV_10X_gc | CLKCTRL_PEN_bm)
+#elif CLOCK_PRESCALER == 12
+#define CLOCK_MCLKCTRLB         (CLKCTRL_PDIV_12X_gc | CLKCTRL_PEN_bm)
+#elif CLOCK_PRESCALER == 16
+#define CLOCK_MCLKCTRLB         (CLKCTRL_PDIV_16X_gc | CLKCTRL_PEN_bm)
+#elif CLOCK_PRESCALER == 24
+#define CLOCK_MCLKCTRLB         (CLKCTRL_PDIV_24X_gc | CLKCTRL_PEN_bm)
+#elif CLOCK_PRESCALER == 32
+#define CLOCK_MCLKCTRLB         (CLKCTRL_PDIV_32X_gc | CLKCTRL_PEN_bm)
+#elif CLOCK_PRESCALER == 48
+#define CLOCK_MCLKCTRLB         (CLKCTRL_PDIV_48X_gc | CLKCTRL_PEN_bm)
+#elif CLOCK_PRESCALER == 64
+#define CLOCK_MCLKCTRLB         (CLKCTRL_PDIV_64X_gc | CLKCTRL_PEN_bm)
+#else
+#error "CLOCK_PRESCALER is not a main clock prescaler setting"
+#endif
+
+/* system tick on TCA0, sys_clk/1 */
+#define CLOCK_TICK_HZ           1000
+#define CLOCK_TCA_PERIOD        (F_CPU / CLOCK_TICK_HZ - 1)
+
+#if F_CPU % CLOCK_TICK_HZ != 0
+#error "F_CPU is not a whole number of timer clocks per tick, the tick would drift"
+#endif
+#if CLOCK_TCA_PERIOD > 0xFFFF
+#error "tick period does not fit TCA0's 16 bit counter"
+#endif
+
+/* SPI to the radio: the fastest SCK F_CPU divides down to that stays within
+   CLOCK_SPI_MAX_HZ. The SX127x takes up to 10 MHz, this leaves margin for the wiring */
+#define CLOCK_SPI_MAX_HZ        8000000UL
+
+#if F_CPU / 2 <= CLOCK_SPI_MAX_HZ
+#define CLOCK_SPI_DIV           2
+#define CLOCK_SPI_CTRLA         (SPI_PRESC_DIV4_gc | SPI_CLK2X_bm)
+#elif F_CPU / 4 <= CLOCK_SPI_MAX_HZ
+#define CLOCK_SPI_DIV           4
+#define CLOCK_SPI_CTRLA         SPI_PRESC_DIV4_gc
+#elif F_CPU / 8 <= CLOCK_SPI_MAX_HZ
+#define CLOCK_SPI_DIV           8
+#define CLOCK_SPI_CTRLA         (SPI_PRESC_DIV16_gc | SPI_CLK2X_bm)
+#else
+#define CLOCK_SPI_DIV           16
+#define CLOCK_SPI_CTRLA         SPI_PRESC_DIV16_gc
+#endif
+
+#define CLOCK_SPI_HZ            (F_CPU / CLOCK_SPI_DIV)
+
+/* USART in normal mode: 16 samples per bit, BAUD register with 6 fractional
+   bits (datasheet table 23-1), rounded to nearest */
+#define CLOCK_USART_BAUD_VALUE(BAUD) ((4 * F_CPU + (BAUD) / 2) / (BAUD))
+// Baud rate error in tenths of a percent
+#define CLOCK_USART_ERROR_PERMILLE(BAUD) \
+    ((4 * F_CPU > CLOCK_USART_BAUD_VALUE(BAUD) * (BAUD) ? \
+      4 * F_CPU - CLOCK_USART_BAUD_VALUE(BAUD) * (BAUD) : \
+      CLOCK_USART_BAUD_VALUE(BAUD) * (BAUD) - 4 * F_CPU) * 1000 / (4 * F_CPU))
+// Largest error the receiving end tolerates
+#define CLOCK_USART_MAX_ERROR_PERMILLE 20
+
+#endif /* __CLOCK_H_ */
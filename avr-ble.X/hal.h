@@ -0,0 +1,79 @@
+#ifndef __HAL_H_
+#define __HAL_H_
+
+/*
+Hardware abstraction layer
+
+Everything spi.c, uart.c, tca.c and lora.c need from the chip. hal_avr.c
+implements it on the ATmega3208. sim/hal_host.c implements it on a PC
+against the simulated SX127x in sim/sx127x.c; that build defines HAL_HOST.
+
+The interrupt vectors live with the implementation and call back into the
+drivers: lora_dio0_isr(), uart_dre_isr(), tca_tick_isr(),
+button_edge_isr() and spi_isr().
+*/
+
+#include <stdint.h>
+#include "ecode.h"
+
+#ifndef HAL_HOST
+#include <avr/io.h>
+#endif
+
+/* main clock, see clock.h */
+// Set the main clock prescaler. Call first thing, everything else runs on F_CPU
+void hal_clock_init();
+
+/* SPI host, SPI0 on PORTA */
+void hal_spi_init();
+// Drive CS low (selected = 1) or high (selected = 0)
+void hal_spi_select(uint8_t selected);
+// Clock 'command', then 'len' bytes out of 'output' (zeros if 0) and into 'input' (dropped
+// if 0), back to back. ECODE_FAIL if it has not finished 100 us after it should have. The
+// timeout runs on tca_micros(), so tca_init() has to come first and interrupts be on
+ECODE hal_spi_transfer(uint8_t command, const uint8_t *output, uint8_t *input, uint8_t len);
+// Byte by byte for spi.c's queue, in the same buffered mode: room in the transmit buffer, and
+// a byte in the receive buffer. With the interrupt on, a byte coming in calls spi_isr()
+uint8_t hal_spi_tx_ready();
+void hal_spi_write(uint8_t c);
+uint8_t hal_spi_rx_ready();
+uint8_t hal_spi_read();
+void hal_spi_irq(uint8_t enable);
+
+/* radio control pins, RST_PIN and INT_PIN on PORTA */
+// RST as output, DIO0 as rising edge interrupt calling lora_dio0_isr()
+void hal_radio_init();
+void hal_radio_reset(uint8_t level);
+// DIO0 rose and lora_dio0_isr() has not run for it yet. Clears it, so it will not
+uint8_t hal_radio_irq_take();
+
+/* UART, USART2 on PORTF */
+void hal_uart_init(uint32_t baud_rate);
+// Data register empty, hal_uart_write() will not block
+uint8_t hal_uart_tx_ready();
+void hal_uart_write(uint8_t c);
+// Enable or disable the data register empty interrupt calling uart_dre_isr()
+void hal_uart_tx_irq(uint8_t enable);
+
+/* buttons, ARM and IGNITE (pins in button.h), pulled up and closing to ground */
+// Inputs with pull-ups, both edges interrupt calling button_edge_isr()
+void hal_button_init();
+// 1 while 'button' (BUTTON_ARM, BUTTON_IGNITE) is held down
+uint8_t hal_button_down(uint8_t button);
+
+/* tick timer, TCA0 */
+// Overflow every period + 1 system clocks, calling tca_tick_isr()
+void hal_tick_init(uint16_t period);
+uint16_t hal_tick_count();
+// Overflow happened but the interrupt has not run yet
+uint8_t hal_tick_overflow_pending();
+
+/* core */
+void hal_delay_ms(uint16_t ms);
+// Disable interrupts and return the previous state for hal_irq_restore()
+uint8_t hal_irq_save();
+void hal_irq_restore(uint8_t state);
+// Nothing to do until the next interrupt. Advances simulated time on the host
+void hal_idle();
+
+#endif /* __HAL_H_ */
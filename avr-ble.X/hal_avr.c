@@ -0,0 +1,253 @@
+#include "clock.h"
+// A transaction gives up this long past its own duration, a byte being 8 SCK periods
+#define HAL_SPI_TIMEOUT_US 100
+#define HAL_SPI_BYTE_US ((8 * 1000000UL + CLOCK_SPI_HZ - 1) / CLOCK_SPI_HZ)
+// Polls of the SPI flags without a byte coming in before the timer is read. A poll takes over
+// 8 CPU clocks and a byte 8 * CLOCK_SPI_DIV, so a transfer that is moving never reads it
+#define HAL_SPI_SPINS (10 * CLOCK_SPI_DIV)
+
+
+#include "hal.h"
+#include "spi.h"
+#include "uart.h"
+#include "tca.h"
+#include "lora.h"
+#include "button.h"
+
+#include <util/delay.h>
+#include <avr/interrupt.h>
+
+ISR(PORTA_PORT_vect) {
+    if(PORTA.INTFLAGS & INT_PIN) {
+        /* LORA INTERRUPT */
+        lora_dio0_isr();
+        PORTA.INTFLAGS = INT_PIN;
+    }
+}
+
+ISR(PORTC_PORT_vect) {
+    if (PORTC.INTFLAGS & ARM_BUTTON_PIN) {
+        /* clear first, an edge while the handler runs sets it again */
+        PORTC.INTFLAGS = ARM_BUTTON_PIN;
+        button_edge_isr(BUTTON_ARM);
+    }
+}
+
+ISR(PORTD_PORT_vect) {
+    if (PORTD.INTFLAGS & IGNITE_BUTTON_PIN) {
+        PORTD.INTFLAGS = IGNITE_BUTTON_PIN;
+        button_edge_isr(BUTTON_IGNITE);
+    }
+}
+
+ISR(SPI0_INT_vect) {
+    spi_isr();
+}
+
+ISR(USART2_DRE_vect) {
+    uart_dre_isr();
+}
+
+ISR(TCA0_OVF_vect) {
+    tca_tick_isr();
+    /* The interrupt flag has to be cleared manually */
+    TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;
+}
+
+void hal_clock_init() {
+    /* configuration change protected register */
+    _PROTECTED_WRITE(CLKCTRL.MCLKCTRLB, CLOCK_MCLKCTRLB);
+}
+
+void hal_spi_init() {
+    PORTA.DIR |= MOSI_PIN; /* Set MOSI pin direction to output */
+    PORTA.DIR &= ~MISO_PIN; /* Set MISO pin direction to input */
+    PORTA.DIR |= CLK_PIN; /* Set SCK pin direction to output */
+    PORTA.DIR |= CS_PIN; /* Set CS pin direction to output */
+    SPI0.CTRLA = CLOCK_SPI_CTRLA /* SCK = F_CPU / CLOCK_SPI_DIV, see clock.h */ /* MSB is transmitted first */
+    | SPI_ENABLE_bm /* Enable module */
+    | SPI_MASTER_bm; /* SPI module in Host mode */
+    /* Buffered mode: a byte waits in the transmit buffer while the one before shifts, SCK
+       does not stop between them. Client select disabled, CS is driven by hand */
+    SPI0.CTRLB = SPI_BUFEN_bm | SPI_SSD_bm | SPI_MODE_0_gc; /* Data Mode 0 */
+}
+
+void hal_spi_select(uint8_t selected) {
+    if (selected) {
+        PORTA.OUT &= ~CS_PIN; // Set CS pin value to LOW
+    } else {
+        PORTA.OUT |= CS_PIN; // Set CS pin value to HIGH
+    }
+}
+
+ECODE hal_spi_transfer(uint8_t command, const uint8_t *output, uint8_t *input, uint8_t len) {
+    /* byte 0 is the command, 1 to len the data. At most two in flight, one shifting and one
+       in the transmit buffer, so the two byte receive buffer cannot overflow */
+    uint16_t total = len + 1;
+    uint16_t sent = 0;
+    uint16_t received = 0;
+    uint16_t spins = HAL_SPI_SPINS;
+    /* one deadline for the whole transaction, from the first time it stalls */
+    uint8_t stalled = 0;
+    uint32_t stalledAt = 0;
+    uint32_t limit = HAL_SPI_TIMEOUT_US + total * HAL_SPI_BYTE_US;
+    while (received < total) {
+        uint8_t flags = SPI0.INTFLAGS;
+        if (sent < total && sent - received < 2 && (flags & SPI_DREIF_bm)) {
+            SPI0.DATA = sent == 0 ? command : (output ? output[sent - 1] : 0);
+            sent++;
+        }
+        if (flags & SPI_RXCIF_bm) {
+            uint8_t in = SPI0.DATA;
+            if (received > 0 && input) input[received - 1] = in;
+            received++;
+            spins = HAL_SPI_SPINS;
+        } else if (--spins == 0) {
+            spins = HAL_SPI_SPINS;
+            if (!stalled) {
+                stalled = 1;
+                stalledAt = tca_micros();
+            } else if (tca_micros_since(stalledAt) > limit) {
+                /* an interrupt may have held us past the deadline after the byte was done */
+                if (!(SPI0.INTFLAGS & SPI_RXCIF_bm)) return ECODE_FAIL;
+            }
+        }
+    }
+    return ECODE_OK;
+}
+
+uint8_t hal_spi_tx_ready() {
+    return (SPI0.INTFLAGS & SPI_DREIF_bm) != 0;
+}
+
+void hal_spi_write(uint8_t c) {
+    SPI0.DATA = c;
+}
+
+uint8_t hal_spi_rx_ready() {
+    return (SPI0.INTFLAGS & SPI_RXCIF_bm) != 0;
+}
+
+uint8_t hal_spi_read() {
+    /* RXCIF clears once the receive buffer is empty */
+    return SPI0.DATA;
+}
+
+void hal_spi_irq(uint8_t enable) {
+    if (enable) {
+        SPI0.INTCTRL |= SPI_RXCIE_bm;
+    } else {
+        SPI0.INTCTRL &= ~SPI_RXCIE_bm;
+    }
+}
+
+void hal_radio_init() {
+    /* lora reset pin */
+    PORTA.DIRSET |= RST_PIN;
+    /* lora interrupt pin setup */
+    PORTA.DIRSET &= ~INT_PIN; // interrupt pin
+    /* enable interrupt on rising edge */
+    PORTA.PIN3CTRL |= PORT_ISC_RISING_gc;
+}
+
+void hal_radio_reset(uint8_t level) {
+    if (level) {
+        PORTA.OUT |= RST_PIN;
+    } else {
+        PORTA.OUT &= ~RST_PIN;
+    }
+}
+
+uint8_t hal_radio_irq_take() {
+    if (!(PORTA.INTFLAGS & INT_PIN)) return 0;
+    PORTA.INTFLAGS = INT_PIN;
+    return 1;
+}
+
+void hal_button_init() {
+    PORTC.DIR &= ~ARM_BUTTON_PIN;
+    PORTC.PIN1CTRL = PORT_PULLUPEN_bm | PORT_ISC_BOTHEDGES_gc;
+    PORTD.DIR &= ~IGNITE_BUTTON_PIN;
+    PORTD.PIN6CTRL = PORT_PULLUPEN_bm | PORT_ISC_BOTHEDGES_gc;
+}
+
+uint8_t hal_button_down(uint8_t button) {
+    if (button == BUTTON_ARM) {
+        return (PORTC.IN & ARM_BUTTON_PIN) == 0;
+    }
+    return (PORTD.IN & IGNITE_BUTTON_PIN) == 0;
+}
+
+void hal_uart_init(uint32_t baud_rate) {
+    PORTF.DIR |= TX_PIN;
+    PORTF.DIR &= ~RX_PIN;
+    // PORTMUX.USARTROUTEA |= PORTMUX_USART2_0_bm;
+    // PORTF.PIN0CTRL |= PORT_PULLUPEN_bm;
+
+    // USART2.DBGCTRL = USART_DBGRUN_bm;
+    USART2.BAUD = CLOCK_USART_BAUD_VALUE(baud_rate);
+    USART2.CTRLB |= USART_TXEN_bm | USART_RXEN_bm;
+    USART2.CTRLC = USART_CMODE_ASYNCHRONOUS_gc | USART_CHSIZE_8BIT_gc | USART_RXMODE_NORMAL_gc;
+}
+
+uint8_t hal_uart_tx_ready() {
+    return (USART2.STATUS & USART_DREIF_bm) != 0;
+}
+
+void hal_uart_write(uint8_t c) {
+    USART2.TXDATAL = c;
+}
+
+void hal_uart_tx_irq(uint8_t enable) {
+    if (enable) {
+        USART2.CTRLA |= USART_DREIE_bm;
+    } else {
+        USART2.CTRLA &= ~USART_DREIE_bm;
+    }
+}
+
+void hal_tick_init(uint16_t period) {
+    /* enable overflow interrupt */
+    TCA0.SINGLE.INTCTRL = TCA_SINGLE_OVF_bm;
+
+    /* set Normal mode */
+    TCA0.SINGLE.CTRLB = TCA_SINGLE_WGMODE_NORMAL_gc;
+
+    /* disable event counting */
+    TCA0.SINGLE.EVCTRL &= ~(TCA_SINGLE_CNTEI_bm);
+
+    /* set the period */
+    TCA0.SINGLE.PER = period;
+
+    TCA0.SINGLE.CTRLA = TCA_SINGLE_CLKSEL_DIV1_gc /* set clock
+    source (sys_clk/1) */
+    | TCA_SINGLE_ENABLE_bm; /* start timer */
+}
+
+uint16_t hal_tick_count() {
+    return TCA0.SINGLE.CNT;
+}
+
+uint8_t hal_tick_overflow_pending() {
+    return (TCA0.SINGLE.INTFLAGS & TCA_SINGLE_OVF_bm) != 0;
+}
+
+void hal_delay_ms(uint16_t ms) {
+    /* _delay_ms() needs a compile time constant */
+    while (ms--) {
+        _delay_ms(1);
+    }
+}
+
+uint8_t hal_irq_save() {
+    uint8_t sreg = SREG;
+    cli();
+    return sreg;
+}
+
+void hal_irq_restore(uint8_t state) {
+    SREG = state;
+}
+
+void hal_idle() {
+}
\ No newline at end of file
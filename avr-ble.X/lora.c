@@ -1,42 +1,172 @@
-#define F_CPU 3333333
+#include "clock.h"
 
 #include "lora.h"
 #include "spi.h"
+#include "toa.h"
+#include "trace.h"
+#include "tca.h"
 
-// Buffer for receiving data
-uint8_t buf[MAX_PKT_LENGTH];
+#include <string.h>
 
 // IRQ pin flag. Note volatile specifier, because this variable is used in interrupt
 volatile uint8_t rx_done_flag;
+// tca_micros() when DIO0 signalled RxDone
+static volatile uint32_t rx_done_at;
+// Same as above, but set when DIO0 fires while mapped to TxDone
+volatile uint8_t tx_done_flag;
+// Set from the start of an async transmit until its completion has been handled
+static volatile uint8_t tx_busy;
+// tca_millis() when the async transmit started, and how it ended
+static uint32_t tx_started;
+static ECODE tx_status;
+// Preamble for the next packet sent, 0 for none, see lora_set_tx_preamble()
+static uint16_t tx_preamble;
+// What the queued SPI transactions of a transmit write, kept until they have: the packet,
+// its length and the register values. Set from the SPI interrupt if one of them failed
+static uint8_t tx_fifo[LORA_TX_MAX_LEN];
+static uint8_t tx_len;
+static const uint8_t tx_fifo_addr = 0;
+static const uint8_t tx_dio_mapping = DIO0_TX_DONE;
+static const uint8_t tx_op_mode = MODE_LONG_RANGE_MODE | MODE_TX;
+static volatile uint8_t tx_queue_failed;
+
+// SPI cost of the last packet sent/received, see lora_last_tx_spi_bytes()
+static uint16_t tx_spi_bytes;
+static uint16_t rx_spi_bytes;
+
+// Received packets, rx_queue[rx_head] the oldest. Filled by lora_receive(), emptied by lora_rx_pop()
+static lora_packet_t rx_queue[LORA_RX_QUEUE];
+static uint8_t rx_head;
+static uint8_t rx_count;
+static lora_rx_stats_t rx_stats;
+// RegRxPacketCnt at the last packet read out, it counts from entering receive
+static uint16_t rx_valid;
+// Added to every frequency lora_set_freq() programs, see lora_set_freq_correction()
+static int32_t freq_correction;
+// The correction in the frequency mirrored, in the one the chip is on, and in the one it was on at RxDone
+static int32_t shadow_correction;
+static volatile int32_t tuned_correction;
+static volatile int32_t rx_done_correction;
+
+// Configuration registers mirrored in RAM, in address order. Runs of consecutive
+// addresses go out in one burst. REG_PA_RAMP and REG_SYMB_TIMEOUT_LSB are never
+// changed, they are here to join the runs around them
+static const uint8_t shadow_regs[] = {
+	REG_FRF_MSB, REG_FRF_MID, REG_FRF_LSB, REG_PA_CONFIG, REG_PA_RAMP, REG_OCP, REG_LNA,
+	REG_FIFO_TX_BASE_ADDR, REG_FIFO_RX_BASE_ADDR,
+	REG_MODEM_CONFIG_1, REG_MODEM_CONFIG_2, REG_SYMB_TIMEOUT_LSB, REG_PREAMBLE_MSB, REG_PREAMBLE_LSB,
+	REG_MODEM_CONFIG_3,
+	REG_PA_DAC,
+};
+#define SHADOW_COUNT ((uint8_t) (sizeof(shadow_regs) / sizeof(shadow_regs[0])))
+
+static uint8_t shadow[SHADOW_COUNT];
+// Bit per shadow_regs entry, set when the mirror differs from the chip
+static uint16_t shadow_dirty;
 
 // Callback function pointer
-static void (*lora_rx_event_callback)(uint8_t * buf, uint8_t len, uint8_t status);
+static void (*lora_tx_done_callback)(ECODE status);
 
-ISR(PORTA_PORT_vect) {
-    if(PORTA.INTFLAGS & PIN3_bm) {
-        /* LORA INTERRUPT */
+static void lora_read_packet();
+
+void lora_dio0_isr() {
+    if (tx_busy) {
+        tx_done_flag = 1;
+        trace_point(TRACE_TX_DONE);
+    } else {
+        rx_done_at = tca_micros();
+        rx_done_correction = tuned_correction;
         rx_done_flag = 1;
-        PORTA.INTFLAGS = PIN3_bm;
+        trace_point(TRACE_RX_DONE);
     }
 }
 
+static uint8_t shadow_index(uint8_t reg) {
+	for (uint8_t i = 0; i < SHADOW_COUNT; i++) {
+		if (shadow_regs[i] == reg) return i;
+	}
+	return 0; // not reached, only shadowed registers are passed
+}
+
+static uint8_t shadow_get(uint8_t reg) {
+	return shadow[shadow_index(reg)];
+}
+
+static void shadow_set(uint8_t reg, uint8_t value) {
+	uint8_t i = shadow_index(reg);
+	if (shadow[i] == value) return;
+	shadow[i] = value;
+	shadow_dirty |= 1 << i;
+}
+
+// Last entry of the run of consecutive addresses starting at entry 'first'
+static uint8_t shadow_run_end(uint8_t first) {
+	uint8_t last = first;
+	while (last + 1 < SHADOW_COUNT && shadow_regs[last + 1] == shadow_regs[last] + 1) {
+		last++;
+	}
+	return last;
+}
+
+// Fill the mirror from the chip, one burst per run
+static ECODE shadow_load() {
+	ECODE status = ECODE_OK;
+	for (uint8_t first = 0; first < SHADOW_COUNT; first = shadow_run_end(first) + 1) {
+		uint8_t last = shadow_run_end(first);
+		status |= lora_read_burst(shadow_regs[first], &shadow[first], last - first + 1);
+	}
+	shadow_dirty = 0;
+	return status;
+}
+
+ECODE lora_apply_config() {
+	ECODE status = ECODE_OK;
+	for (uint8_t first = 0; first < SHADOW_COUNT && shadow_dirty; first = shadow_run_end(first) + 1) {
+		uint8_t last = shadow_run_end(first);
+		/* from the first to the last dirty register of the run, clean ones in between
+		   cost a byte each, less than a separate transaction */
+		while (first <= last && !(shadow_dirty & (1 << first))) first++;
+		while (last > first && !(shadow_dirty & (1 << last))) last--;
+		if (first > last) continue;
+		status |= lora_write_burst(shadow_regs[first], &shadow[first], last - first + 1);
+		for (uint8_t i = first; i <= last; i++) {
+			shadow_dirty &= ~(1 << i);
+		}
+	}
+	/* the chip is on the mirrored frequency now */
+	uint8_t sreg = hal_irq_save();
+	tuned_correction = shadow_correction;
+	hal_irq_restore(sreg);
+	return status;
+}
+
+ECODE lora_verify_config() {
+	ECODE status = ECODE_OK;
+	for (uint8_t first = 0; first < SHADOW_COUNT; first = shadow_run_end(first) + 1) {
+		uint8_t last = shadow_run_end(first);
+		uint8_t chip[SHADOW_COUNT];
+		if (lora_read_burst(shadow_regs[first], chip, last - first + 1) != ECODE_OK) return ECODE_FAIL;
+		for (uint8_t i = first; i <= last; i++) {
+			/* dirty ones are expected to differ until applied */
+			if (!(shadow_dirty & (1 << i)) && chip[i - first] != shadow[i]) {
+				shadow_dirty |= 1 << i;
+				status = ECODE_FAIL;
+			}
+		}
+	}
+	return status;
+}
+
 ECODE lora_init() {
 	spi_init();
-    /* lora reset pin */
-    PORTA.DIRSET |= RST_PIN;
-    /* lora interrupt pin setup */
-    PORTA.DIRSET &= ~INT_PIN; // interrupt pin
-    /* enable interrupt on rising edge */
-    PORTA.PIN3CTRL |= PORT_ISC_RISING_gc;
-    
-    PORTA.OUT |= RST_PIN;
-	_delay_ms(50);
-	PORTA.OUT &= ~RST_PIN;
-	_delay_ms(1);
-	PORTA.OUT |= RST_PIN;
-	_delay_ms(10);
+    hal_radio_init();
 
-	spi_disable();
+    hal_radio_reset(1);
+	hal_delay_ms(50);
+	hal_radio_reset(0);
+	hal_delay_ms(1);
+	hal_radio_reset(1);
+	hal_delay_ms(10);
 
 	uint8_t version;
     lora_read_register(REG_VERSION, &version);
@@ -45,35 +175,41 @@ ECODE lora_init() {
 	lora_sleep();
 	lora_write_register(REG_OP_MODE, MODE_LONG_RANGE_MODE);
 
+	// Reset values into the mirror, the setters below work on it
+	if (shadow_load() != ECODE_OK) return ECODE_FAIL;
+
 	lora_set_freq(FREQUENCY);
 
-	lora_write_register(REG_FIFO_TX_BASE_ADDR, 0);
-	lora_write_register(REG_FIFO_RX_BASE_ADDR, 0);
+	shadow_set(REG_FIFO_TX_BASE_ADDR, 0);
+	shadow_set(REG_FIFO_RX_BASE_ADDR, 0);
 
 	// Datasheet page: 95
 	// RegLna: 7-5 lnaGain, 4-3 lnaBoostLf, 2 reserved, 1-0 lnaboostHf
-    uint8_t lna;
-    lora_read_register(REG_LNA, &lna);
-	lora_write_register(REG_LNA, lna | 0b11);
+	shadow_set(REG_LNA, shadow_get(REG_LNA) | 0b11);
 
 	// Datasheet page: 114
 	// RegModemConfig3: 7-4 unused, 3 LowDataRateOptimize, 2 AgcAutoOn, 1-0 reserved
-	lora_write_register(REG_MODEM_CONFIG_3, 0b100);
+	shadow_set(REG_MODEM_CONFIG_3, (LOW_DATA_RATE_OPTIMIZE << 3) | 0b100);
+
+	lora_set_preamble_length(PREAMBLE_LENGTH);
 
 	// Map DIO0 to RX_DONE irq
-	lora_write_register(REG_DIO_MAPPING_1, 0x00);
+	lora_write_register(REG_DIO_MAPPING_1, DIO0_RX_DONE);
 
 	lora_set_bandwidth(BANDWIDTH);
 	lora_set_spreading_factor(SPREADING_FACTOR);
 	lora_set_coding_rate(CODING_RATE);
+	lora_payload_crc(PAYLOAD_CRC);
 
 	lora_tx_power(20);
 
 	lora_explicit_header();
 
+	lora_apply_config();
+
 	lora_standby();
 
-	_delay_ms(50);
+	hal_delay_ms(50);
 
 	lora_rx_continuous();
 
@@ -82,26 +218,27 @@ ECODE lora_init() {
 
 ECODE lora_read_register(uint8_t reg, uint8_t *output) {
 	// To read register, 8th bit has to be set to 0, which is achieved with masking with 0x7f
-    ECODE status = ECODE_OK;
-	spi_enable();
-	// Send register address
-	status |= spi_tx(reg & 0x7f);
-	// Read register value from module
-	status |= spi_rx(output);
-	spi_disable();
-	return status;
+	return spi_transaction(reg & 0x7f, 0, output, 1);
 }
 
 ECODE lora_write_register(uint8_t reg, uint8_t value) {
 	// When writing to register, 8th bit has to be 1.
-    ECODE status = ECODE_OK;
-	spi_enable();
-	// Send register address
-	status |= spi_tx(reg | 0x80);
-	// Read register value from module
-	status |= spi_tx(value);
-	spi_disable();
-	return status;
+	return spi_transaction(reg | 0x80, &value, 0, 1);
+}
+
+ECODE lora_read_burst(uint8_t reg, uint8_t *output, uint8_t len) {
+	// Datasheet page 80: the address is sent once, then every following byte
+	// in the same NSS window reads the next address (or the next FIFO byte)
+	return spi_transaction(reg & 0x7f, 0, output, len);
+}
+
+ECODE lora_write_burst(uint8_t reg, const uint8_t *input, uint8_t len) {
+	return spi_transaction(reg | 0x80, input, 0, len);
+}
+
+// The same, queued: 'input' has to stay valid until 'callback' runs
+static ECODE lora_queue_write(uint8_t reg, const uint8_t *input, uint8_t len, void (*callback)(ECODE status)) {
+	return spi_queue(reg | 0x80, input, 0, len, callback);
 }
 
 void lora_sleep() {
@@ -121,11 +258,20 @@ void lora_set_freq(uint32_t freq) {
 	// And multiply by 2 to n power is equal to shifting by n to left
 
 	#define F_XOSC 32000000UL
-	uint64_t f_Rf = ((uint64_t)(freq) << 19) / F_XOSC;
+	uint64_t f_Rf = ((uint64_t)(freq + freq_correction) << 19) / F_XOSC;
 
-	lora_write_register(REG_FRF_MSB, (f_Rf >> 16) & 0xFF);
-	lora_write_register(REG_FRF_MID, (f_Rf >> 8) & 0xFF);
-	lora_write_register(REG_FRF_LSB, (f_Rf >> 0) & 0xFF);
+	shadow_set(REG_FRF_MSB, (f_Rf >> 16) & 0xFF);
+	shadow_set(REG_FRF_MID, (f_Rf >> 8) & 0xFF);
+	shadow_set(REG_FRF_LSB, (f_Rf >> 0) & 0xFF);
+	shadow_correction = freq_correction;
+}
+
+void lora_set_freq_correction(int32_t hz) {
+	freq_correction = hz;
+}
+
+int32_t lora_freq_correction() {
+	return freq_correction;
 }
 
 // OverCurrentProtection
@@ -146,7 +292,7 @@ uint8_t lora_set_ocp(uint8_t max_current) {
 	}
 
 	// REG_OCP: 7-6 unused, 5 enable overload current protection, 4-0 ocp_trim
-	lora_write_register(REG_OCP, (1<<5) | (ocp_trim & 0b00011111));
+	shadow_set(REG_OCP, (1<<5) | (ocp_trim & 0b00011111));
 
 	return 1;
 }
@@ -155,11 +301,8 @@ void lora_explicit_header() {
 	// Datasheet page 29
 	// Explicit mode: preamble + header + crc + payload + payload_crc
     
-	uint8_t reg_modem_config_1;
-    lora_read_register(REG_MODEM_CONFIG_1, &reg_modem_config_1);
-
 	// RegModemConfig1: 7-4 signal bandwith, 3-1 error coding rate, 0 header type
-	lora_write_register(REG_MODEM_CONFIG_1, reg_modem_config_1 & 0b11111110);
+	shadow_set(REG_MODEM_CONFIG_1, shadow_get(REG_MODEM_CONFIG_1) & 0b11111110);
 }
 
 // Note: RSSI can be as low as -164. Then its outside of int8_t range (-128 to 127)
@@ -169,6 +312,20 @@ int16_t lora_last_packet_rssi(uint32_t freq) {
 	return -(freq < RF_MID_BAND_THRESHOLD ? RSSI_OFFSET_LF_PORT : RSSI_OFFSET_HF_PORT) + rssi;
 }
 
+// Same offsets as the packet RSSI: -164 + RssiValue on the LF port
+int16_t lora_rssi(uint32_t freq) {
+	uint8_t rssi;
+	lora_read_register(REG_RSSI_VALUE, &rssi);
+	return -(freq < RF_MID_BAND_THRESHOLD ? RSSI_OFFSET_LF_PORT : RSSI_OFFSET_HF_PORT) + rssi;
+}
+
+int8_t lora_last_packet_snr() {
+	// Datasheet page 111: two's complement, in 0.25 dB steps
+	uint8_t snr;
+	lora_read_register(REG_PKT_SNR_VALUE, &snr);
+	return ((int8_t) snr) / 4;
+}
+
 void lora_tx_power(uint8_t db) {
 	// Datasheet page 84
 
@@ -186,12 +343,12 @@ void lora_tx_power(uint8_t db) {
 
 	if(db > 17) {
 		if( db > 20 ) db = 20; // Clamp max power to 20
-		lora_write_register(REG_PA_DAC, (0x10 << 3) | 0x07 );
-		lora_write_register(REG_PA_CONFIG, PA_BOOST | ((db - 2) - 3));
+		shadow_set(REG_PA_DAC, (0x10 << 3) | 0x07 );
+		shadow_set(REG_PA_CONFIG, PA_BOOST | ((db - 2) - 3));
 	} else {
 		if( db < 2 ) db = 2; // Clamp min power to 2
-		lora_write_register(REG_PA_DAC, (0x10 << 3) | 0x04 );
-		lora_write_register(REG_PA_CONFIG, PA_BOOST | (db - 2));
+		shadow_set(REG_PA_DAC, (0x10 << 3) | 0x04 );
+		shadow_set(REG_PA_CONFIG, PA_BOOST | (db - 2));
 	}
 
 }
@@ -199,18 +356,35 @@ void lora_tx_power(uint8_t db) {
 void lora_set_bandwidth( uint8_t mode ) {
 	// RegModemConfig1: 7-4 Bandwidth, 3-1 CodingRate, 0 ImplicitHeaderModeOn
 	// Datasheet page 112
-    uint8_t modem_config_1;
-    lora_read_register(REG_MODEM_CONFIG_1, &modem_config_1);
-	lora_write_register(REG_MODEM_CONFIG_1, (modem_config_1 & 0b00001111) | (mode << 4));
+	shadow_set(REG_MODEM_CONFIG_1, (shadow_get(REG_MODEM_CONFIG_1) & 0b00001111) | (mode << 4));
 }
 
 void lora_set_spreading_factor(uint8_t sf)
 {
 	// DataSheet page 113
 	// RegModemConfig2: 7-4 SpreadingFactor 3 TxContinuousMode 2 RxPauloadCrcOn 1-0 SymbolTimeout (msb)
-    uint8_t modem_config_2;
-    lora_read_register(REG_MODEM_CONFIG_2, &modem_config_2);
-	lora_write_register(REG_MODEM_CONFIG_2, (modem_config_2 & 0b00001111) | (sf << 4));
+	shadow_set(REG_MODEM_CONFIG_2, (shadow_get(REG_MODEM_CONFIG_2) & 0b00001111) | (sf << 4));
+}
+
+void lora_set_preamble_length(uint16_t symbols) {
+	shadow_set(REG_PREAMBLE_MSB, (symbols >> 8) & 0xFF);
+	shadow_set(REG_PREAMBLE_LSB, symbols & 0xFF);
+}
+
+void lora_set_tx_preamble(uint16_t symbols) {
+	tx_preamble = symbols;
+}
+
+void lora_payload_crc(uint8_t on) {
+	// Datasheet page 113
+	// RegModemConfig2: 7-4 SpreadingFactor 3 TxContinuousMode 2 RxPayloadCrcOn 1-0 SymbolTimeout (msb)
+	uint8_t modem_config_2 = shadow_get(REG_MODEM_CONFIG_2);
+	if (on) {
+		modem_config_2 |= 0b00000100;
+	} else {
+		modem_config_2 &= 0b11111011;
+	}
+	shadow_set(REG_MODEM_CONFIG_2, modem_config_2);
 }
 
 void lora_set_coding_rate( uint8_t rate ) {
@@ -218,53 +392,207 @@ void lora_set_coding_rate( uint8_t rate ) {
 
 	// Datasheet page 112
 	// RegModemConfig1: 7-4 Bandwidth, 3-1 CodingRate, 0 ImplicitHeaderModeOn
-    uint8_t modem_config_1;
-    lora_read_register(REG_MODEM_CONFIG_1, &modem_config_1);
-	lora_write_register(REG_MODEM_CONFIG_1, (modem_config_1 & 0b11110001) | (rate << 1));
+	shadow_set(REG_MODEM_CONFIG_1, (shadow_get(REG_MODEM_CONFIG_1) & 0b11110001) | (rate << 1));
 }
 
-void register_lora_rx_event_callback(void (*callback)(uint8_t * buf, uint8_t len, uint8_t status)) {
-	lora_rx_event_callback = callback;
+ECODE lora_rx_pop(lora_packet_t *packet) {
+	if (rx_count == 0) return ECODE_FAIL;
+	*packet = rx_queue[rx_head];
+	rx_head = (rx_head + 1) % LORA_RX_QUEUE;
+	rx_count--;
+	return ECODE_OK;
+}
+
+void lora_rx_stats(lora_rx_stats_t *stats) {
+	*stats = rx_stats;
 }
 
 void lora_rx_continuous() {
+	// Every caller comes from standby or sleep, the chip starts counting packets again
+	rx_valid = 0;
 	lora_write_register(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_RX_CONTINUOUS);
 }
 
-void lora_send(uint8_t *buf, uint8_t len) {
+ECODE lora_send(uint8_t *buf, uint8_t len) {
+	if (len == 0) return ECODE_FAIL;
+
+	while (lora_send_async(buf, len, 0) != ECODE_OK) {
+		hal_idle();
+		lora_receive();
+	}
+	while (tx_busy) {
+		hal_idle();
+		lora_receive();
+	}
+	return tx_status;
+}
+
+// Completions of the queued transmit steps, from the SPI interrupt
+static void tx_step(ECODE status) {
+	if (status != ECODE_OK) tx_queue_failed = 1;
+}
+
+static void tx_loaded(ECODE status) {
+	tx_step(status);
+	trace_point(TRACE_FIFO_END);
+}
+
+static void tx_requested(ECODE status) {
+	tx_step(status);
+	trace_point(TRACE_TX_START);
+}
+
+ECODE lora_send_async(uint8_t *buf, uint8_t len, void (*callback)(ECODE status)) {
 	// Datasheet page 38
 	// 1. Mode request STAND-BY
 	// 2. TX init
 	// 3. Write data to FIFO
 	// 4. Mode request TX
-	// 5. Wait for IRQ TxDone
+	// 5. Wait for IRQ TxDone (DIO0, handled in lora_receive)
 	// 6. Auto mode change to STAND-BY
 	// 7. If new tx, go to 3
 	// 8. New mode request
 
 	// The LoRaTM FIFO can only be filled in Standby mode.
+	// Both FIFO base addresses are 0, so loading a packet would overwrite one
+	// that has been received but not read yet.
+
+	if (len == 0 || len > LORA_TX_MAX_LEN || tx_busy) return ECODE_FAIL;
 
-	if (len == 0) return;
+	uint32_t spi_start = spi_byte_count();
+	trace_point(TRACE_FIFO_START);
 
+	// In standby no packet comes in any more. One that did up to then is flagged or has its
+	// interrupt pending: taken here with interrupts off, it can neither slip past the check
+	// nor run once tx_busy is set and pass for TxDone. Read it out before the FIFO is loaded
+	uint8_t sreg = hal_irq_save();
 	lora_standby();
+	if (hal_radio_irq_take()) lora_dio0_isr();
+	uint8_t received = rx_done_flag;
+	hal_irq_restore(sreg);
+	if (received) {
+		uint32_t read_start = spi_byte_count();
+		lora_read_packet();
+		rx_done_flag = 0;
+		spi_start += spi_byte_count() - read_start;
+	}
 
-	lora_write_register(REG_FIFO_ADDR_PTR, 0);
+	/* the preamble is a modem setting, changed in standby only */
+	if (tx_preamble) {
+		lora_set_preamble_length(tx_preamble);
+		tx_preamble = 0;
+		lora_apply_config();
+	}
 
-	for (uint8_t i = 0; i < len; i++) {
-        lora_write_register(REG_FIFO, buf[i]);
-    }
-	lora_write_register(REG_PAYLOAD_LENGTH, len);
+	memcpy(tx_fifo, buf, len);
+	tx_len = len;
+	lora_tx_done_callback = callback;
+	tx_started = tca_millis();
+	tx_busy = 1;
+	// The FIFO load and the mode change run from the SPI interrupt, the caller goes on meanwhile.
+	// A failure shows as tx_queue_failed, lora_receive() ends the transmit with it
+	ECODE status = lora_queue_write(REG_FIFO_ADDR_PTR, &tx_fifo_addr, 1, tx_step);
+	status |= lora_queue_write(REG_FIFO, tx_fifo, len, tx_loaded);
+	status |= lora_queue_write(REG_PAYLOAD_LENGTH, &tx_len, 1, tx_step);
+	status |= lora_queue_write(REG_DIO_MAPPING_1, &tx_dio_mapping, 1, tx_step);
+	status |= lora_queue_write(REG_OP_MODE, &tx_op_mode, 1, tx_requested);
+	if (status != ECODE_OK) tx_queue_failed = 1;
+
+	tx_spi_bytes = spi_byte_count() - spi_start;
+	return ECODE_OK;
+}
 
-	lora_write_register(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_TX);
+uint8_t lora_tx_busy() {
+	return tx_busy;
+}
 
-	uint8_t irqv;
-    lora_read_register(REG_IRQ_FLAGS, &irqv);
-	while((irqv & IRQ_TX_DONE_MASK) == 0) {
-        lora_read_register(REG_IRQ_FLAGS, &irqv);
-    }
+static void lora_tx_done(ECODE status) {
+	// A timed out packet may still be going, stop it
+	if (status != ECODE_OK) lora_standby();
+	// Clear TxDone before handing DIO0 back to RxDone, otherwise the still
+	// asserted line would look like a received packet
+	lora_write_register(REG_IRQ_FLAGS, IRQ_TX_DONE_MASK);
+	lora_write_register(REG_DIO_MAPPING_1, DIO0_RX_DONE);
+	lora_rx_continuous();
+	tx_done_flag = 0;
+	tx_queue_failed = 0;
+	tx_busy = 0;
+	tx_status = status;
+	if (lora_tx_done_callback) lora_tx_done_callback(status);
+}
+
+// RSSI offset of the port the mirrored frequency is on
+static int16_t rssi_offset() {
+	uint32_t frf = ((uint32_t) shadow_get(REG_FRF_MSB) << 16) | ((uint16_t) shadow_get(REG_FRF_MID) << 8)
+			| shadow_get(REG_FRF_LSB);
+	return frf < (uint32_t) (RF_MID_BAND_THRESHOLD * 524288 / 32000000UL) ? RSSI_OFFSET_LF_PORT : RSSI_OFFSET_HF_PORT;
+}
+
+// RegFreqError, the frequency error indication: 20 bit two's complement. The carrier offset
+// in Hz is FreqError * 2^24 / F_XOSC * BW / 500 kHz, and 2^24 / 32 MHz / 500 kHz = 256 / 244140625.
+// The datasheet gives the size, not which way round: positive is taken as the received carrier
+// above the one the radio is tuned to, as the sim's model has it. Not yet confirmed on hardware;
+// afc.c undoes a retune that makes the error grow, which is what the wrong sign would do
+static int32_t freq_error_hz(const uint8_t *fei) {
+	int32_t value = ((int32_t) (fei[0] & 0x0F) << 16) | ((uint16_t) fei[1] << 8) | fei[2];
+	if (value & 0x80000L) value -= 0x100000L;
+	return (int64_t) value * (int32_t) TOA_BW_HZ(shadow_get(REG_MODEM_CONFIG_1) >> 4) * 256 / 244140625L;
+}
+
+// Move the packet RxDone signalled from the radio into the queue
+static void lora_read_packet() {
+	// RegFifoRxCurrentAddr up to RegPktRssiValue in one burst: start and length of the
+	// packet, the IRQ flags, the packet count, SNR and RSSI
+	uint8_t regs[REG_PKT_RSSI_VALUE - REG_FIFO_RX_CURRENT_ADDR + 1];
+	uint32_t spi_start = spi_byte_count();
+	lora_read_burst(REG_FIFO_RX_CURRENT_ADDR, regs, sizeof(regs));
+	uint8_t irqv = regs[REG_IRQ_FLAGS - REG_FIFO_RX_CURRENT_ADDR];
+
+	// Clear irq status
 	lora_write_register(REG_IRQ_FLAGS, irqv);
 
-	lora_rx_continuous();
+	if (irqv & IRQ_PAYLOAD_CRC_ERROR_MASK) {
+		rx_stats.crc_errors++;
+		return;
+	}
+	if (!(irqv & IRQ_RX_DONE_MASK)) return;
+
+	// The count goes up by more than one if a packet came in on top of another before
+	// this read it out: the radio keeps only the last one's length, RSSI and SNR
+	uint16_t valid = ((uint16_t) regs[REG_RX_PACKET_CNT_MSB - REG_FIFO_RX_CURRENT_ADDR] << 8)
+			| regs[REG_RX_PACKET_CNT_LSB - REG_FIFO_RX_CURRENT_ADDR];
+	if (valid > rx_valid + 1) rx_stats.missed += valid - rx_valid - 1;
+	rx_valid = valid;
+
+	uint8_t len = regs[REG_RX_NB_BYTES - REG_FIFO_RX_CURRENT_ADDR];
+	if (len > LORA_RX_MAX_LEN) {
+		rx_stats.too_long++;
+		return;
+	}
+	if (rx_count == LORA_RX_QUEUE) {
+		rx_stats.overflow++;
+		return;
+	}
+	lora_packet_t *packet = &rx_queue[(rx_head + rx_count) % LORA_RX_QUEUE];
+	packet->len = len;
+	packet->rssi = -rssi_offset() + regs[REG_PKT_RSSI_VALUE - REG_FIFO_RX_CURRENT_ADDR];
+	// Datasheet page 111: two's complement, in 0.25 dB steps
+	packet->snr = ((int8_t) regs[REG_PKT_SNR_VALUE - REG_FIFO_RX_CURRENT_ADDR]) / 4;
+	packet->at = rx_done_at;
+	uint8_t fei[REG_FREQ_ERROR_LSB - REG_FREQ_ERROR_MSB + 1];
+	lora_read_burst(REG_FREQ_ERROR_MSB, fei, sizeof(fei));
+	/* what the radio was tuned to when it took the packet, it may have been retuned since */
+	packet->freq_error = freq_error_hz(fei) + rx_done_correction;
+
+	// Set FIFO address to beginning of the last received packet.
+	lora_write_register(REG_FIFO_ADDR_PTR, regs[0]);
+	// Read FIFO to buffer, RadioHead header included (see proto.h)
+	lora_read_burst(REG_FIFO, packet->data, len);
+	rx_spi_bytes = spi_byte_count() - spi_start;
+
+	rx_count++;
+	rx_stats.received++;
+	if (rx_count > rx_stats.peak) rx_stats.peak = rx_count;
 }
 
 void lora_receive() {
@@ -277,40 +605,22 @@ void lora_receive() {
 	// 6. Read rx data
 	// 7. New mode request
 
+	if (tx_done_flag) {
+		lora_tx_done(ECODE_OK);
+	} else if (tx_busy && (tx_queue_failed || tca_millis_since(tx_started) > LORA_TX_TIMEOUT_MS)) {
+		lora_tx_done(ECODE_FAIL);
+	}
+
 	if(rx_done_flag) {
-		uint8_t len;
-		uint8_t irqv;
-        lora_read_register(REG_IRQ_FLAGS, &irqv);
-
-		// Clear irq status
-		lora_write_register(REG_IRQ_FLAGS, irqv);
-
-		// Check if crc error occur
-		if ((irqv & IRQ_PAYLOAD_CRC_ERROR_MASK)) {
-			// If yes, run callback with crc error status and none data
-			if (lora_rx_event_callback) lora_rx_event_callback(0, 0, IRQ_PAYLOAD_CRC_ERROR_MASK);
-		} else if ((irqv & IRQ_RX_DONE_MASK)) {
-			// Check how many data arrived
-			lora_read_register(REG_RX_NB_BYTES, &len);
-
-			// Set FIFO address to beginning of the last received packet.
-            uint8_t rx_current;
-            lora_read_register(REG_FIFO_RX_CURRENT_ADDR, &rx_current);
-			lora_write_register(REG_FIFO_ADDR_PTR, rx_current);
-            
-            // Read four bytes of header (discard)
-            uint8_t dummy;
-            for (uint8_t i = 0; i < 4; i++) {
-                lora_read_register(REG_FIFO, &dummy);
-            }
-
-			// Read FIFO to buffer
-			for (uint8_t i = 0; i < len - 4; i++) {
-                lora_read_register(REG_FIFO, &buf[i]);
-            }
-			// Run callback with data
-			if (lora_rx_event_callback) lora_rx_event_callback(buf, len, IRQ_RX_DONE_MASK);
-		}
+		lora_read_packet();
 		rx_done_flag = 0;
 	}
 }
+
+uint16_t lora_last_tx_spi_bytes() {
+	return tx_spi_bytes;
+}
+
+uint16_t lora_last_rx_spi_bytes() {
+	return rx_spi_bytes;
+}
@@ -1,10 +1,7 @@
 #ifndef __LORA_H_
 #define __LORA_H_
 
-#include <avr/io.h>
-#include <util/delay.h>
-#include <avr/interrupt.h>
-#include "ecode.h"
+#include "hal.h"
 
 //Registers
 #define REG_FIFO					0x00
@@ -13,6 +10,7 @@
 #define REG_FRF_MID					0x07
 #define REG_FRF_LSB					0x08
 #define REG_PA_CONFIG				0x09
+#define REG_PA_RAMP					0x0a
 #define REG_OCP						0x0b
 #define REG_LNA						0x0c
 #define REG_FIFO_ADDR_PTR			0x0d
@@ -21,11 +19,14 @@
 #define REG_FIFO_RX_CURRENT_ADDR	0x10
 #define REG_IRQ_FLAGS				0x12
 #define REG_RX_NB_BYTES				0x13
+#define REG_RX_PACKET_CNT_MSB		0x16
+#define REG_RX_PACKET_CNT_LSB		0x17
 #define REG_PKT_SNR_VALUE			0x19
 #define REG_PKT_RSSI_VALUE			0x1a
 #define REG_RSSI_VALUE				0x1b
 #define REG_MODEM_CONFIG_1			0x1d
 #define REG_MODEM_CONFIG_2			0x1e
+#define REG_SYMB_TIMEOUT_LSB		0x1f
 #define REG_PREAMBLE_MSB			0x20
 #define REG_PREAMBLE_LSB			0x21
 #define REG_PAYLOAD_LENGTH			0x22
@@ -51,6 +52,10 @@
 #define MODE_RX_CONTINUOUS			0x05
 #define MODE_RX_SINGLE				0x06
 
+//DIO0 mapping, RegDioMapping1 bits 7-6
+#define DIO0_RX_DONE				0x00
+#define DIO0_TX_DONE				0x40
+
 //PA config
 #define PA_BOOST					0x80
 
@@ -99,6 +104,21 @@
 #define CODING_RATE				CODING_RATE_4_5
 #define BANDWIDTH				BANDWIDTH_125_KHZ
 #define FREQUENCY				433E6
+// Preamble symbols, programmed into RegPreambleMsb/Lsb
+#define PREAMBLE_LENGTH			8
+// Append a payload CRC on transmit (RxPayloadCrcOn), must match the receiver's setPayloadCRC()
+#define PAYLOAD_CRC				0
+// Required when the symbol time exceeds 16 ms (SF11 and SF12 at 125 kHz)
+#define LOW_DATA_RATE_OPTIMIZE	0
+// Give up on a TxDone that never comes. A full 255 byte packet at SF10/125 kHz
+// with the wake-up preamble is on air for about 2.3 s
+#define LORA_TX_TIMEOUT_MS		3000
+// Received packets held until the application takes them, and the longest kept.
+// Longer packets are counted and dropped without reading the FIFO
+#define LORA_RX_QUEUE			4
+#define LORA_RX_MAX_LEN			32
+// Longest packet lora_send_async() takes, it keeps a copy while SPI loads it in the background
+#define LORA_TX_MAX_LEN			32
 
 /* Reset pin - PA2 */
 #define RST_PIN     PIN2_bm
@@ -107,6 +127,26 @@
 //==============================================
 //==============================================
 
+// A received packet, RadioHead header included
+typedef struct {
+	uint8_t len;
+	int16_t rssi;		// dBm
+	int8_t snr;			// dB
+	uint32_t at;		// tca_micros() at RxDone
+	int32_t freq_error;	// Hz, the sender's carrier above the nominal frequency (no correction)
+	uint8_t data[LORA_RX_MAX_LEN];
+} lora_packet_t;
+
+// Receive counters since power-up
+typedef struct {
+	uint16_t received;	// queued for the application
+	uint16_t overflow;	// dropped, the queue was full
+	uint16_t missed;	// overwritten in the radio by the next one before lora_receive() read it out
+	uint16_t crc_errors;
+	uint16_t too_long;	// longer than LORA_RX_MAX_LEN
+	uint8_t peak;		// most packets queued at once
+} lora_rx_stats_t;
+
 // Init SX1278 module
 ECODE lora_init();
 
@@ -116,6 +156,27 @@ ECODE lora_read_register(uint8_t reg, uint8_t *output);
 // Write register on address 'reg' with 'value' value
 ECODE lora_write_register(uint8_t reg, uint8_t value);
 
+// Read 'len' bytes starting at 'reg' in a single burst access.
+// The address auto-increments, except on REG_FIFO where it reads consecutive FIFO bytes
+ECODE lora_read_burst(uint8_t reg, uint8_t *output, uint8_t len);
+
+// Write 'len' bytes starting at 'reg' in a single burst access.
+// The address auto-increments, except on REG_FIFO where it fills consecutive FIFO bytes
+ECODE lora_write_burst(uint8_t reg, const uint8_t *input, uint8_t len);
+
+// Configuration registers (frequency, PA, OCP, LNA, FIFO bases, modem config,
+// preamble) are mirrored in RAM. The setters below that change them only update
+// the mirror and mark the register dirty; lora_apply_config() writes what changed.
+// Change modem settings in sleep or standby, not while receiving or transmitting.
+
+// Write every dirty configuration register, contiguous ones in one burst
+ECODE lora_apply_config();
+
+// Read the configuration back and compare it with the mirror. ECODE_FAIL if the
+// chip differs (e.g. it was reset); the differing registers are marked dirty so
+// the next lora_apply_config() restores them
+ECODE lora_verify_config();
+
 // Put module into sleep mode with LoRa
 void lora_sleep();
 // Put module into standby mode with LoRa
@@ -123,11 +184,19 @@ void lora_standby();
 // Put module into receive continuous mode
 void lora_rx_continuous();
 
-// Main library event function. This should run in non-blocked main loop
+// Main library event function. This should run in non-blocked main loop, at least once
+// per shortest packet time: it finishes transmits and moves a received packet from the
+// radio into the queue
 void lora_receive();
 
-//Register callback function for receiving data
-void register_lora_rx_event_callback(void (*callback)(uint8_t * buf, uint8_t len, uint8_t status));
+// DIO0 rising edge handler, called from the HAL
+void lora_dio0_isr();
+
+//Take the oldest received packet off the queue. ECODE_FAIL if there is none
+ECODE lora_rx_pop(lora_packet_t *packet);
+
+//Copy the receive counters
+void lora_rx_stats(lora_rx_stats_t *stats);
 
 //Set over current protection on module
 uint8_t lora_set_ocp(uint8_t max_current);
@@ -140,13 +209,27 @@ void lora_set_bandwidth(uint8_t mode);
 //Use provided definitions from lora_mem.h
 void lora_set_spreading_factor(uint8_t sf);
 
+//Preamble length in symbols, for transmit and the longest expected in receive
+void lora_set_preamble_length(uint16_t symbols);
+//The same, taking effect with the next packet: lora_send_async() sets it once the radio is in standby
+void lora_set_tx_preamble(uint16_t symbols);
+
 //Set coding rate
 //Use provided definitions from lora_mem.h
 void lora_set_coding_rate(uint8_t rate);
 
+//Enable or disable the payload CRC
+void lora_payload_crc(uint8_t on);
+
 //Read Received Signal Strength Indicator (RSSI) from last received packet
 int16_t lora_last_packet_rssi(uint32_t freq);
 
+//Read the RSSI on the channel right now, in dBm. Only meaningful in receive mode
+int16_t lora_rssi(uint32_t freq);
+
+//Read the signal to noise ratio of the last received packet in dB
+int8_t lora_last_packet_snr();
+
 //Use explicit header mode. Module send: Preamble + Header + CRC + Payload + Payload CRC
 void lora_explicit_header();
 
@@ -154,8 +237,29 @@ void lora_explicit_header();
 void lora_tx_power(uint8_t db);
 //Set working frequency. For SX1278 default value is 433 MHz
 void lora_set_freq(uint32_t freq);
+//Hz added to the frequency from the next lora_set_freq() on, to make up for the crystal's error
+void lora_set_freq_correction(int32_t hz);
+int32_t lora_freq_correction();
+
+//Transmit data from buf and wait for TxDone, ECODE_FAIL if it timed out.
+//Relies on the DIO0 interrupt, so it must not be called with interrupts disabled
+ECODE lora_send(uint8_t *buf, uint8_t len);
+
+//Start transmitting data from buf and return immediately. DIO0 is mapped to TxDone
+//for the time on air; lora_receive() picks up the completion, returns the module to
+//receive mode and runs 'callback' (may be 0), with ECODE_FAIL if TxDone did not come
+//within LORA_TX_TIMEOUT_MS or the SPI transfer failed. The packet goes into the FIFO
+//over queued SPI transactions (spi.h), 'buf' can be reused at once. Fails if a packet
+//is already on air or longer than LORA_TX_MAX_LEN. A received packet not read out of
+//the FIFO yet goes into the queue first.
+ECODE lora_send_async(uint8_t *buf, uint8_t len, void (*callback)(ECODE status));
+
+//Non-zero while a packet started with lora_send_async() is on air
+uint8_t lora_tx_busy();
 
-//Transmit data from buf
-void lora_send(uint8_t *buf, uint8_t len);
+//SPI bytes spent loading and starting the last transmitted packet (TxDone polling excluded)
+uint16_t lora_last_tx_spi_bytes();
+//SPI bytes spent reading out the last received packet
+uint16_t lora_last_rx_spi_bytes();
 
 #endif /* __LORA_H_ */
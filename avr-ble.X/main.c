@@ -7,24 +7,50 @@ avr-ble:
 https://ww1.microchip.com/downloads/aemDocuments/documents/MCU08/ProductDocuments/UserGuides/AVR-BLE-Hardware-User-Guide-DS50002956B.pdf
 */
 
-#define F_CPU 3333333
+#include "clock.h"
 
 #include <avr/io.h>
 #include <util/delay.h>
 #include <avr/interrupt.h>
 #include <avr/wdt.h>
 
-#include <string.h>
 #include <stdio.h>
 
 #include "uart.h"
 #include "tca.h"
 #include "lora.h"
+#include "sched.h"
+#include "proto.h"
+#include "toa.h"
+#include "adr.h"
+#include "trace.h"
+#include "button.h"
+#include "pad.h"
+#include "chan.h"
+#include "telem.h"
+#include "afc.h"
+
+/* pads fitted, a mask of pad numbers (proto.h): bit 0 for pad 1 */
+#ifndef PADS_FITTED
+#define PADS_FITTED           0x01
+#endif
+
+/* 1 for a line on the console per packet sent and the ignite path trace after every ignite.
+   Off, received packets still go out as telemetry (telem.h) and the statistics every 10 s */
+#ifndef CONSOLE_VERBOSE
+#define CONSOLE_VERBOSE       0
+#endif
+
+/* how long ARM has to be held before IGNITE fires */
+#define ARM_HOLD_MS           1000
+/* IGNITE LED blink period when IGNITE went unanswered */
+#define IGNITE_BLINK_MS       250
+/* IGNITE LED after a pad is selected: flashes of this period, one per pad number, or one this long for all */
+#define SELECT_BLINK_MS       200
+#define SELECT_ALL_MS         1000
+/* IGNITE held this long without ARM steps the selection, a tap does nothing */
+#define SELECT_HOLD_MS        1000
 
-/* ARM_BUTTON_PIN - PC1 */
-#define ARM_BUTTON_PIN        PIN1_bm
-/* IGNITE_BUTTON_PIN - PD6 */
-#define IGNITE_BUTTON_PIN     PIN6_bm
 /* DC_BUZZER_PIN - PD1 */
 #define DC_BUZZER_PIN         PIN1_bm
 
@@ -40,20 +66,90 @@ https://ww1.microchip.com/downloads/aemDocuments/documents/MCU08/ProductDocument
 #define RED_IGN_LED_PIN       PIN3_bm
 
 uint8_t ledToggle = 0;
-uint32_t millis = 0;
 uint32_t ledMillis = 0;
 uint8_t receivedGood = 0;
 uint8_t hasConnection = 0;
 uint8_t mustRelease = 0;
+uint8_t txSeq = 0; // sequence number of the next frame sent
+uint8_t padsFitted = PADS_FITTED;
+uint8_t selectedPads; // the pads ARM and IGNITE act on, all fitted ones to start with
+uint8_t selectedPad = 0; // the one selected, 0 for all
+uint8_t selectHeld = 0; // this IGNITE press has stepped the selection, or began with ARM held
+uint8_t selectShowing = 0; // the IGNITE LED shows the selection made at selectShowAt
+uint32_t selectShowAt;
 
-void parse_lora(uint8_t * buf, uint8_t len, uint8_t status);
-void sendIgnite(); // send ignite key to receiver
-uint32_t armButtonDown; // how many milliseconds the arm button has been down for
-uint8_t armButtonBuffer = 0;
-uint8_t igniteButtonBuffer = 0;
+void parse_lora(const lora_packet_t *packet);
+void sendTelemetry(const lora_packet_t *packet, const proto_frame_t *frame);
+void initFrame(proto_frame_t *frame, uint8_t op);
+void startIgnite(); // send ignite key to the selected pads, retried until answered
+void sendIgnite();
+void igniteSent(ECODE status);
+void igniteTimedOut();
+uint16_t igniteAnswerMs();
+void igniteAnswered(uint8_t pad, uint8_t op);
+void setFastPoll(uint8_t on);
+uint16_t pollPeriod(uint8_t pads);
+uint8_t receiverListening(uint8_t pads);
+uint8_t answerExpected();
+void heartbeatSent(ECODE status);
+void closeBeat();
+void selectPreamble(uint8_t pads);
+void selectNext();
+void showPads();
+uint8_t beatSlots();
+uint32_t statusBound();
+uint32_t igniteWaitBound();
+int8_t linkSignal(int8_t signal, int16_t rssi, int8_t snr);
+uint8_t ignitePending = 0; // ignite requested while another packet was on air
+uint8_t armed = 0; // ARM held for ARM_HOLD_MS with a connection
 uint8_t firstTick = 0;
+uint8_t buttonTaskId;
+uint8_t ratePending = 0; // the heartbeat is RATE, switching once the pads answer it
+uint8_t newRate;
+uint8_t newPower;
+uint8_t newChannel;
+uint8_t heartbeatTaskId;
+uint32_t lastBeatAt; // tca_millis() of the last heartbeat sent
+uint8_t beatDeferred = 0; // the heartbeat found the channel busy, radioTask runs it again
+uint8_t fastPoll = 0; // ARM held, heartbeat every adr_poll_ms()
+uint8_t pollPending = 0; // the heartbeat is a fast poll
+uint8_t beatSeq; // the last heartbeat's sequence number
+uint8_t beatPads = 0; // pads it polled
+uint8_t beatAnswered = 0; // and the ones that have answered it
+uint8_t beatOpen = 0; // more answers may come, closeBeat() not run yet
+int8_t weakestSignal; // the weakest answer to it, for link adaptation
+int16_t weakestRssi;
+int8_t weakestSnr;
+uint8_t beatOffAir = 0; // the last heartbeat went off air at beatOffAirAt
+uint32_t beatOffAirAt;
+uint32_t answerAt; // the last answer to it came in
+uint8_t igniteActive = 0; // IGNITE being sent, until it is answered or given up on
+proto_frame_t igniteFrame; // every try has the same sequence number
+uint8_t ignitePads; // the pads it fires
+uint8_t igniteDone; // the pads that have answered, with IGNITED or REFUSED
+uint8_t igniteRefusedPads;
+uint32_t igniteAnswerAt; // the last answer to it came in
+uint8_t igniteSeq;
+uint8_t igniteTries;
+uint32_t igniteStartAt;
+uint8_t igniteAnswerPending = 0; // IGNITE went off air at igniteSentAt, IGNITED or REFUSED not in yet
+uint32_t igniteSentAt;
+uint8_t igniteUnanswered = 0; // gave up on a pad, the IGNITE LED blinks red until the next ARM
+uint16_t igniteRetries = 0; // tries after the first, since power-up
+
+/* scheduler tasks */
+void radioTask();
+void buttonTask();
+void ledTask();
+void heartbeatTask();
+void statsTask();
+void traceTask();
+void chanTask();
+void buttonChanged(uint8_t button, uint8_t pressed);
 
 int main() {
+    hal_clock_init();
+
     /* pin init */
     PORTC.DIR |= LORA_LED_PIN;
     PORTD.DIR |= GREEN_CONT_LED_PIN;
@@ -61,157 +157,634 @@ int main() {
     PORTA.DIR |= GREEN_IGN_LED_PIN;
     PORTF.DIR |= RED_IGN_LED_PIN;
     PORTD.DIR |= DC_BUZZER_PIN;
-    PORTC.DIR &= ~ARM_BUTTON_PIN;
-    PORTC.PIN1CTRL |= PORT_PULLUPEN_bm;
-    PORTD.DIR &= ~IGNITE_BUTTON_PIN;
-    PORTD.PIN6CTRL |= PORT_PULLUPEN_bm;
     
     PORTD.OUT |= GREEN_CONT_LED_PIN; // start yellow
     PORTD.OUT |= RED_CONT_LED_PIN;
     PORTA.OUT &= ~GREEN_IGN_LED_PIN; // start off
     PORTF.OUT &= ~RED_IGN_LED_PIN;
-    uart_init(9600);
+    uart_init(UART_BAUD_RATE);
     if (tca_init()) {
         uart_tx("RTC could not initialise\r\n");
+        uart_flush();
         while (1);
     }
     uart_tx("RTC successfully initialised\r\n");
+    /* time runs on the tick interrupt, and the SPI and TX timeouts in lora_init() and
+       chan_survey() wait on it. Until the scheduler is registered below, ticks only count */
+    sei();
+    button_init();
     if(lora_init()) {
         uart_tx("lora could not initialise\r\n");
+        uart_flush();
 		while(1); // If init returns 0, error occur. Check connections and try again.
 	}
     uart_tx("lora successfully initialised\r\n\r\n");
-    register_lora_rx_event_callback(parse_lora);
-    sei();
+    adr_init();
+    pad_init(padsFitted);
+    selectedPads = padsFitted;
+    chan_init();
+    afc_init();
+    chan_survey();
+    char chanStr[64];
+    char *p = chanStr + sprintf(chanStr, "channels busy:");
+    for (uint8_t ch = 0; ch < PROTO_CHANNEL_COUNT; ch++) {
+        p += sprintf(p, " %u%%", chan_busy(ch));
+    }
+    sprintf(p, "\r\n");
+    uart_tx(chanStr);
+    uint8_t slots = beatSlots();
+    char padStr[64];
+    sprintf(padStr, "pads %02x: %u a heartbeat, status within %lu ms\r\n",
+            padsFitted, slots, statusBound());
+    uart_tx(padStr);
+    /* commands carry the long preamble that wakes the receiver, its answers the short one */
+    toa_config_t toaConfig;
+    toa_default_config(&toaConfig);
+    toaConfig.preamble = proto_wake_preamble(PROTO_RATE_DEFAULT);
+    uint32_t pingUs = toa_packet_us(&toaConfig, PROTO_HEADER_LEN + proto_body_len(PROTO_OP_PING));
+    toaConfig.preamble = PROTO_PREAMBLE_SHORT;
+    uint32_t statusUs = toa_packet_us(&toaConfig, PROTO_HEADER_LEN + proto_body_len(PROTO_OP_STATUS));
+    char toaStr[72];
+    sprintf(toaStr, "time on air: ping %lu us (%u symbol preamble), status %lu us\r\n",
+            pingUs, proto_wake_preamble(PROTO_RATE_DEFAULT), statusUs);
+    uart_tx(toaStr);
+
+    /* the button scan goes first so it is never queued behind housekeeping in the same pass */
+    uint8_t taskId;
+    ECODE status = ECODE_OK;
+    status |= sched_add("buttons", buttonTask, 1, &buttonTaskId);
+    status |= sched_add("radio", radioTask, 1, &taskId);
+    status |= sched_add("led", ledTask, 10, &taskId);
+    status |= sched_add("heartbeat", heartbeatTask, PROTO_HEARTBEAT_MS, &heartbeatTaskId);
+    status |= sched_add("stats", statsTask, 10000, &taskId);
+    status |= sched_add("trace", traceTask, 10, &taskId);
+    status |= sched_add("channel", chanTask, CHAN_SAMPLE_MS, &taskId);
+    if (status) {
+        uart_tx("scheduler could not initialise\r\n");
+        uart_flush();
+        while (1);
+    }
+    register_tca_tick_callback(sched_tick);
+    register_button_callback(buttonChanged);
 	while(1) {
-		lora_receive();
-        if ((PORTC.IN & ARM_BUTTON_PIN) == 0) {
-            armButtonBuffer = 10;
-        }
-        if (armButtonBuffer) {
-            armButtonDown++;
-        }
-        if (armButtonBuffer > 0) {
-            armButtonBuffer--;
-        } else {
-            armButtonDown = 0;
-        }
-        if ((PORTD.IN & IGNITE_BUTTON_PIN) == 0) {
-            igniteButtonBuffer = 10;
-        }
-        if (igniteButtonBuffer > 0) {
-            igniteButtonBuffer--;
+        sched_run();
+        hal_idle();
+	}
+}
+
+/* service radio interrupts, handle a received packet and any ignite that had to wait for
+   the air - every millisecond. One packet a run, the rest wait in the driver's queue */
+void radioTask() {
+    lora_receive();
+    lora_packet_t packet;
+    if (lora_rx_pop(&packet) == ECODE_OK) parse_lora(&packet);
+    if (beatDeferred) sched_post(heartbeatTaskId);
+    if (ignitePending) {
+        sendIgnite();
+    } else if (igniteAnswerPending && tca_millis_since(igniteSentAt) >= igniteAnswerMs()) {
+        igniteTimedOut();
+    }
+}
+
+/* a button edge runs the state machine at once instead of on the next tick - from the pin change interrupt */
+void buttonChanged(uint8_t button, uint8_t pressed) {
+    if (button == BUTTON_IGNITE && pressed) {
+        trace_point(TRACE_BUTTON);
+    }
+    sched_post(buttonTaskId);
+}
+
+/* run the arm/ignite state machine on the debounced buttons - every millisecond and on every edge */
+void buttonTask() {
+    button_update();
+    uint8_t ignite = button_pressed(BUTTON_IGNITE);
+    setFastPoll(button_pressed(BUTTON_ARM));
+    if (button_pressed(BUTTON_ARM)) {
+        selectShowing = 0;
+        selectHeld = ignite;
+        if (firstTick == 0 && mustRelease == 0) {
+            /* turn off IGNITE LED */
+            igniteUnanswered = 0;
+            PORTA.OUT &= ~GREEN_IGN_LED_PIN;
+            PORTF.OUT &= ~RED_IGN_LED_PIN;
         }
-        if (millis - ledMillis > 500 && receivedGood) {
-            PORTC.OUT |= LORA_LED_PIN;
+        firstTick = 1;
+        if (hasConnection) {
+            if (mustRelease == 0) {
+                PORTD.OUT |= DC_BUZZER_PIN;
+            }
+            if (armed == 0 && button_held_ms(BUTTON_ARM) >= ARM_HOLD_MS) {
+                /* turn IGNITE LED to YELLOW */
+                armed = 1;
+                PORTA.OUT |= GREEN_IGN_LED_PIN;
+                PORTF.OUT |= RED_IGN_LED_PIN;
+            }
+            if (ignite && mustRelease == 0 && armed) {
+                /* turn IGNITE LED to YELLOW */
+                PORTA.OUT |= GREEN_IGN_LED_PIN;
+                PORTF.OUT |= RED_IGN_LED_PIN;
+                startIgnite();
+                mustRelease = 1;
+                PORTD.OUT &= ~DC_BUZZER_PIN;
+            } else if (ignite && mustRelease == 0) {
+                mustRelease = 1;
+            }
         }
-        if (armButtonBuffer) {
-            firstTick = 1;
-            if (mustRelease == 0 && armButtonDown == 1) {
+    } else {
+        if (firstTick) {
+            PORTD.OUT &= ~DC_BUZZER_PIN;
+            if (mustRelease == 0) {
                 /* turn off IGNITE LED */
                 PORTA.OUT &= ~GREEN_IGN_LED_PIN;
                 PORTF.OUT &= ~RED_IGN_LED_PIN;
             }
-            if (hasConnection) {
-                if (mustRelease == 0) {
-                    PORTD.OUT |= DC_BUZZER_PIN;
-                }
-                if (armButtonDown == 1000) {
-                    /* turn IGNITE LED to YELLOW */
-                    PORTA.OUT |= GREEN_IGN_LED_PIN;
-                    PORTF.OUT |= RED_IGN_LED_PIN;
-                }
-                if (igniteButtonBuffer && mustRelease == 0 && armButtonDown > 1000) {
-                    /* turn IGNITE LED to YELLOW */
-                    PORTA.OUT |= GREEN_IGN_LED_PIN;
-                    PORTF.OUT |= RED_IGN_LED_PIN;
-                    sendIgnite();
-                    mustRelease = 1;
-                    PORTD.OUT &= ~DC_BUZZER_PIN;
-                } else if (igniteButtonBuffer && mustRelease == 0) {
-                    mustRelease = 1;
-                }
-            }
-        } else {
-            if (firstTick) {
-                PORTD.OUT &= ~DC_BUZZER_PIN;
-                if (mustRelease == 0) {
-                    /* turn off IGNITE LED */
-                    PORTA.OUT &= ~GREEN_IGN_LED_PIN;
-                    PORTF.OUT &= ~RED_IGN_LED_PIN;
-                }
-                if (igniteButtonBuffer == 0) {
-                    mustRelease = 0;
-                }
-                firstTick = 0;
+            if (ignite == 0) {
+                mustRelease = 0;
             }
+            firstTick = 0;
+            armed = 0;
         }
-        _delay_ms(1);
-        millis++;
-	}
+        /* IGNITE held on its own picks the pads, a step per press. A tap, meant to fire
+           just as ARM was let go, leaves the selection alone */
+        if (ignite && !selectHeld && button_held_ms(BUTTON_IGNITE) >= SELECT_HOLD_MS) {
+            selectNext();
+            selectHeld = 1;
+        }
+    }
+    if (!ignite) selectHeld = 0;
 }
 
-void parse_lora(uint8_t *buf, uint8_t len, uint8_t status) {
-	//If error, return.
-	if( status == IRQ_PAYLOAD_CRC_ERROR_MASK ) {
-		// ...process error
-		return;
-	}
-	uart_tx("Received: \"");
-    uart_tx((const char *) buf);
-    uart_tx("\"\r\n");
-    uart_tx("RSSI: ");
-    uint16_t rssi = lora_last_packet_rssi(433);
-    char rssiStr[10];
-    sprintf(rssiStr, "%d", rssi);
-    uart_tx(rssiStr);
-    uart_tx("\r\n\r\n");
-    if (strcmp((const char *) buf, "stop") == 0) {
-        /* received continuity OK */
+/* step the selection: all fitted pads, then each of them in turn, then all again */
+void selectNext() {
+    uint8_t fitted = pad_fitted();
+    if (proto_pad_count(fitted) < 2) return;
+    uint8_t id = selectedPad;
+    do {
+        id++;
+    } while (id <= PROTO_PAD_MAX && !(fitted & proto_pad_bit(id)));
+    selectedPad = id <= PROTO_PAD_MAX ? id : 0;
+    selectedPads = selectedPad ? proto_pad_bit(selectedPad) : fitted;
+    selectShowing = 1;
+    selectShowAt = tca_millis();
+    showPads();
+    char selectStr[24];
+    sprintf(selectStr, "Selected pads %02x\r\n", selectedPads);
+    uart_tx(selectStr);
+}
+
+/* the continuity LED and the connection follow the selected pads: yellow unless they are
+   all up, then green if they all have continuity and red if not */
+void showPads() {
+    hasConnection = pad_up(selectedPads);
+    if (!hasConnection) {
+        PORTD.OUT |= GREEN_CONT_LED_PIN;
+        PORTD.OUT |= RED_CONT_LED_PIN;
+    } else if (pad_continuity(selectedPads)) {
         PORTD.OUT |= GREEN_CONT_LED_PIN;
         PORTD.OUT &= ~RED_CONT_LED_PIN;
-        receivedGood = 1;
-        hasConnection = 1;
-    }
-    if (strcmp((const char *) buf, "stal") == 0) {
-        /* received continuity ERROR (no continuity) */
+    } else {
         PORTD.OUT &= ~GREEN_CONT_LED_PIN;
         PORTD.OUT |= RED_CONT_LED_PIN;
-        receivedGood = 1;
-        hasConnection = 1;
     }
-    if (strcmp((const char *) buf, "done") == 0) {
-        /* received ignite OK */
-        PORTA.OUT |= GREEN_IGN_LED_PIN;
+}
+
+/* pulse the RF LED back on half a second after each heartbeat - every 10 milliseconds */
+void ledTask() {
+    if (tca_millis_since(ledMillis) > 500 && receivedGood) {
+        PORTC.OUT |= LORA_LED_PIN;
+    }
+    /* a selection: a flash per pad number, or a long one for all */
+    if (selectShowing) {
+        uint32_t t = tca_millis_since(selectShowAt);
+        uint8_t on;
+        if (selectedPad == 0) {
+            on = t < SELECT_ALL_MS;
+            selectShowing = on;
+        } else {
+            uint32_t n = t / SELECT_BLINK_MS;
+            on = n < 2 * selectedPad && !(n & 1);
+            selectShowing = n < 2 * selectedPad;
+        }
         PORTF.OUT &= ~RED_IGN_LED_PIN;
+        if (on) {
+            PORTA.OUT |= GREEN_IGN_LED_PIN;
+        } else {
+            PORTA.OUT &= ~GREEN_IGN_LED_PIN;
+        }
+    /* IGNITE unanswered: whether it fired is unknown */
+    } else if (igniteUnanswered) {
+        PORTA.OUT &= ~GREEN_IGN_LED_PIN;
+        if ((tca_millis() / IGNITE_BLINK_MS) & 1) {
+            PORTF.OUT |= RED_IGN_LED_PIN;
+        } else {
+            PORTF.OUT &= ~RED_IGN_LED_PIN;
+        }
+    }
+}
+
+/* print the ignite trace requested by the last reply, a line at a time - every 10 milliseconds */
+void traceTask() {
+    trace_dump_step();
+}
+
+/* how busy the channel is between the link's own packets, and a look at the others when the
+   slow heartbeat leaves time for one before the next beat. The frequency correction follows
+   the pads' carriers while no ignite is under way - every CHAN_SAMPLE_MS */
+void chanTask() {
+    uint8_t quiet = !answerExpected() && !igniteAnswerPending;
+    uint8_t spare = quiet && !fastPoll && !igniteActive && !beatDeferred
+            && tca_millis_since(lastBeatAt) + CHAN_DWELL_MS + CHAN_SAMPLE_MS < PROTO_HEARTBEAT_MS;
+    if (quiet && !igniteActive && !beatDeferred) afc_task();
+    chan_task(quiet, spare);
+}
+
+/* print worst-case task timings, dropped log output, the link setting and ignite path stages - every 10 seconds.
+   Also check the radio still holds its configuration, a brown-out resets it to the defaults */
+void statsTask() {
+    if (lora_verify_config() != ECODE_OK) {
+        uart_tx("radio configuration lost, restoring\r\n");
+        if (!lora_tx_busy()) {
+            lora_standby();
+            lora_apply_config();
+            lora_rx_continuous();
+        }
+    }
+    sched_report();
+    char droppedStr[32];
+    sprintf(droppedStr, "uart dropped: %u\r\n", uart_tx_dropped());
+    uart_tx(droppedStr);
+    lora_rx_stats_t rx;
+    lora_rx_stats(&rx);
+    char rxStr[96];
+    sprintf(rxStr, "rx: %u received, queue peak %u of %u, %u overflow, %u missed, %u crc, %u too long\r\n",
+            rx.received, rx.peak, LORA_RX_QUEUE, rx.overflow, rx.missed, rx.crc_errors, rx.too_long);
+    uart_tx(rxStr);
+    char linkStr[96];
+    sprintf(linkStr, "link: rate %u, %u dBm, margin %d dB, afc %ld Hz (%u retunes, %u undone)\r\n", adr_rate(), adr_power(),
+            adr_margin(), lora_freq_correction(), afc_retunes(), afc_undone());
+    uart_tx(linkStr);
+    char chanStr[80];
+    char *p = chanStr + sprintf(chanStr, "channel %u, held back %u, sent busy %u, busy:",
+                                adr_channel(), chan_held(), chan_forced());
+    for (uint8_t ch = 0; ch < PROTO_CHANNEL_COUNT; ch++) {
+        p += sprintf(p, " %u%%", chan_busy(ch));
+    }
+    sprintf(p, "\r\n");
+    uart_tx(chanStr);
+    uint8_t up = 0;
+    for (uint8_t id = 1; id <= PROTO_PAD_MAX; id++) {
+        if (pad_get(id)->up) up |= proto_pad_bit(id);
+    }
+    uint32_t ageMs;
+    uint8_t worst = pad_worst(&ageMs);
+    uint8_t slots = beatSlots();
+    char padStr[96];
+    sprintf(padStr, "pads: up %02x of %02x, %u a heartbeat, status age max %lu ms (pad %u), bound %lu ms\r\n",
+            up, pad_fitted(), slots, ageMs, worst, statusBound());
+    uart_tx(padStr);
+    pad_clear_stats();
+    trace_report();
+}
+
+void parse_lora(const lora_packet_t *packet) {
+    proto_frame_t frame;
+    if (proto_decode(packet->data, packet->len, &frame) == 0) {
+        uart_tx("Received malformed frame\r\n");
+        return;
+    }
+    /* a notification is not an answer to anything this end sent */
+    uint8_t notify = frame.flags & PROTO_FLAG_NOTIFY;
+    sendTelemetry(packet, &frame);
+    uint8_t pad = proto_pad_bit(frame.from);
+    if (frame.to != PROTO_ADDR_CONTROLLER || !(pad & pad_fitted())) {
+        uart_tx("Not from a fitted pad\r\n");
+        return;
+    }
+    afc_packet(frame.from, packet->freq_error, packet->at);
+    switch (frame.op) {
+        case PROTO_OP_STATUS:
+            pad_status(frame.from, frame.status, frame.signal);
+            showPads();
+            /* answers to an earlier heartbeat only tell how the pad is */
+            if (notify || !beatOpen || frame.seq != beatSeq || !(pad & beatPads)) break;
+            receivedGood = 1;
+            answerAt = tca_millis();
+            beatAnswered |= pad;
+            /* the link is as good as its weakest pad */
+            if (beatAnswered == pad || linkSignal(frame.signal, packet->rssi, packet->snr)
+                    < linkSignal(weakestSignal, weakestRssi, weakestSnr)) {
+                weakestSignal = frame.signal;
+                weakestRssi = packet->rssi;
+                weakestSnr = packet->snr;
+            }
+            /* the pad stays in receive for PROTO_POLL_AWAKE_MS */
+            if (pollPending) pad_wake(pad);
+            if (beatAnswered == beatPads) {
+                closeBeat();
+                if (fastPoll) sched_set_period(heartbeatTaskId, pollPeriod(beatPads));
+            }
+            break;
+        case PROTO_OP_IGNITED:
+        case PROTO_OP_REFUSED:
+            igniteAnswered(pad, frame.op);
+            break;
+        default:
+            break;
     }
-    if (strcmp((const char *) buf, "cant") == 0) {
+}
+
+/* a received packet as a binary record on the console, see telem.h */
+void sendTelemetry(const lora_packet_t *packet, const proto_frame_t *frame) {
+    lora_rx_stats_t rx;
+    lora_rx_stats(&rx);
+    telem_rx_t record;
+    record.at = packet->at;
+    record.from = frame->from;
+    record.op = frame->op;
+    record.seq = frame->seq;
+    record.flags = frame->flags;
+    record.status = frame->status;
+    record.signal = frame->signal;
+    record.rssi = packet->rssi;
+    record.snr = packet->snr;
+    record.freq_error = packet->freq_error;
+    record.afc = lora_freq_correction();
+    record.missed = rx.missed;
+    record.overflow = rx.overflow;
+    record.crc_errors = rx.crc_errors;
+    uint8_t wire[TELEM_FRAME_MAX];
+    uart_write(wire, telem_frame_rx(&record, wire));
+}
+
+/* strength of the weaker direction of an answered command, as adr_heartbeat() takes it */
+int8_t linkSignal(int8_t signal, int16_t rssi, int8_t snr) {
+    int8_t local = proto_signal(rssi, snr);
+    return signal < local ? signal : local;
+}
+
+/* IGNITED or REFUSED from 'pad'. Answers to an earlier IGNITE, or repeats, change nothing */
+void igniteAnswered(uint8_t pad, uint8_t op) {
+    if (!(pad & ignitePads) || (igniteDone & pad) || (!igniteActive && !igniteUnanswered)) return;
+    igniteDone |= pad;
+    igniteAnswerAt = tca_millis();
+    if (op == PROTO_OP_REFUSED) igniteRefusedPads |= pad;
+    /* the rest may still answer in their slots */
+    if (igniteDone != ignitePads) return;
+    if (igniteRefusedPads) {
         /* received ignite ERROR */
         PORTA.OUT &= ~GREEN_IGN_LED_PIN;
         PORTF.OUT |= RED_IGN_LED_PIN;
+    } else {
+        /* received ignite OK */
+        PORTA.OUT |= GREEN_IGN_LED_PIN;
+        PORTF.OUT &= ~RED_IGN_LED_PIN;
+    }
+    igniteActive = 0;
+    igniteAnswerPending = 0;
+    ignitePending = 0;
+    igniteUnanswered = 0;
+    trace_point(TRACE_REPLY);
+    if (CONSOLE_VERBOSE) trace_dump();
+}
+
+/* start a controller -> receiver frame with the next sequence number */
+void initFrame(proto_frame_t *frame, uint8_t op) {
+    frame->to = PROTO_ADDR_BROADCAST;
+    frame->from = PROTO_ADDR_CONTROLLER;
+    frame->seq = txSeq++;
+    frame->flags = fastPoll ? PROTO_FLAG_POLL : 0;
+    frame->op = op;
+    frame->status = 0;
+    frame->signal = 0;
+    frame->rate = 0;
+    frame->power = 0;
+    frame->channel = 0;
+    frame->pads = 0;
+}
+
+/* pads a heartbeat polls at the current rate: as many as have an answer slot before the next one */
+uint8_t beatSlots() {
+    return pad_slots(adr_rate(), proto_wake_preamble(adr_rate()), PROTO_HEARTBEAT_MS);
+}
+
+/* how old a pad's STATUS gets at most at the slow heartbeat, fast poll only makes it fresher */
+uint32_t statusBound() {
+    return pad_bound_ms(adr_rate(), proto_wake_preamble(adr_rate()), PROTO_HEARTBEAT_MS);
+}
+
+/* the longest IGNITE waits to go on air: behind a heartbeat with the wake preamble, the answers
+   of every fitted pad and the guard after them, then a busy channel for as long as listen before talk holds */
+uint32_t igniteWaitBound() {
+    uint8_t rate = adr_rate();
+    uint32_t us = proto_frame_us(rate, proto_wake_preamble(rate)) + proto_pad_count(padsFitted) * proto_slot_us(rate);
+    return (us + 999) / 1000 + PROTO_POLL_GUARD_MS + PROTO_LBT_MAX_MS + CHAN_SETTLE_MS;
+}
+
+/* ARM pressed or released: poll fast while it is held, so the connection and continuity
+   shown are fresh when IGNITE is pressed, and at the slow rate the rest of the time */
+void setFastPoll(uint8_t on) {
+    if (fastPoll == on) return;
+    fastPoll = on;
+    if (!on) {
+        sched_set_period(heartbeatTaskId, PROTO_HEARTBEAT_MS);
+        return;
+    }
+    uint16_t period = pollPeriod(beatPads ? beatPads : pad_fitted());
+    sched_set_period(heartbeatTaskId, period);
+    /* the first poll goes now, unless the last heartbeat could still be waiting for its answers */
+    if (tca_millis_since(lastBeatAt) >= period) sched_post(heartbeatTaskId);
+}
+
+/* fast poll period for a window like 'pads' */
+uint16_t pollPeriod(uint8_t pads) {
+    uint16_t preamble = receiverListening(pads) ? PROTO_PREAMBLE_SHORT : proto_wake_preamble(adr_rate());
+    return adr_poll_ms(preamble, proto_pad_count(pads));
+}
+
+/* the pads listen without waking while fast poll keeps them up, give or take a heartbeat */
+uint8_t receiverListening(uint8_t pads) {
+    return pad_awake(pads, PROTO_POLL_AWAKE_MS - PROTO_HEARTBEAT_MS);
+}
+
+/* commands carry the preamble that wakes the pads, unless they are all listening anyway.
+   For the next packet: lora_send_async() sets it in standby, over SPI only if the length changes */
+void selectPreamble(uint8_t pads) {
+    lora_set_tx_preamble(receiverListening(pads) ? PROTO_PREAMBLE_SHORT : proto_wake_preamble(adr_rate()));
+}
+
+/* a pad may be answering the last heartbeat right now: it went off air less than its
+   answer slots ago and not every pad has answered, or they have but the last may not be
+   back in receive yet */
+uint8_t answerExpected() {
+    if (!beatOffAir) return 0;
+    if (beatAnswered == beatPads) return tca_millis_since(answerAt) < PROTO_POLL_GUARD_MS;
+    uint32_t answerMs = proto_pad_count(beatPads) * proto_slot_us(adr_rate()) / 1000;
+    return tca_millis_since(beatOffAirAt) < answerMs;
+}
+
+void heartbeatSent(ECODE status) {
+    beatOffAir = status == ECODE_OK;
+    beatOffAirAt = tca_millis();
+}
+
+/* the heartbeat's answers are all in, or no more can come: mark the pads that missed it,
+   and adapt the link to the weakest answer or to none */
+void closeBeat() {
+    if (!beatOpen) return;
+    beatOpen = 0;
+    uint8_t lost = pad_polled(beatPads, beatAnswered);
+    if (beatAnswered) {
+        adr_heartbeat(weakestSignal, weakestRssi, weakestSnr);
+        if (beatAnswered != beatPads) adr_partial();
+        /* the pads have switched, follow them. If any missed it, the others come back (proto.h) */
+        if (ratePending && beatAnswered == beatPads) {
+            if (adr_apply(newRate, newPower, newChannel) == ECODE_OK) {
+                char rateStr[48];
+                sprintf(rateStr, "Rate %u, %u dBm, channel %u\r\n", newRate, newPower, newChannel);
+                uart_tx(rateStr);
+            }
+        }
+        ratePending = 0;
+        /* one pad lost while others answer: it may have fallen back on its own */
+        if (lost && adr_lost()) {
+            uart_tx("Pad lost, back to the robust rate\r\n");
+        }
+    } else if (adr_miss()) {
+        uart_tx("Link lost, back to the robust rate\r\n");
     }
+    showPads();
+}
+
+void startIgnite() {
+    initFrame(&igniteFrame, PROTO_OP_IGNITE);
+    igniteSeq = igniteFrame.seq;
+    ignitePads = selectedPads;
+    igniteDone = 0;
+    igniteRefusedPads = 0;
+    igniteActive = 1;
+    igniteTries = 0;
+    igniteStartAt = tca_millis();
+    igniteAnswerPending = 0;
+    igniteUnanswered = 0;
+    sendIgnite();
 }
 
+/* IGNITE to the pads that have not answered yet */
 void sendIgnite() {
-    uint8_t message[] = {0xFF, 0xFF, 0xFF, 0xFF, 'I', 'G', 'N', 'I', 'T', 'E', '\0'};
-    lora_send(message, sizeof(message));
-    uart_tx("Sent \"IGNITE\"\r\n");
-}
-
-/* TCA ISR - every second */
-ISR(TCA0_OVF_vect) {
-    uint8_t message[] = {0xFF, 0xFF, 0xFF, 0xFF, 'c', 'o', 'r', 'k', '\0'};
-    lora_send(message, sizeof(message));
-    uart_tx("Sent \"cork\"\r\n");
-    if (receivedGood == 0) {
-        /* didn't receive it last time - toggle continuity LED yellow */
-        PORTD.OUT |= GREEN_CONT_LED_PIN;
-        PORTD.OUT |= RED_CONT_LED_PIN;
-        hasConnection = 0;
+    /* the pads cannot hear it while they answer, nor through someone else's packet;
+       radioTask tries again on its next run */
+    if (answerExpected() || !chan_clear()) {
+        ignitePending = 1;
+        return;
+    }
+    igniteFrame.pads = ignitePads & ~igniteDone;
+    uint8_t message[PROTO_MAX_FRAME];
+    uint8_t len = proto_encode(&igniteFrame, message);
+    selectPreamble(igniteFrame.pads);
+    /* if the heartbeat is still on air, radioTask tries again on its next run */
+    ignitePending = lora_send_async(message, len, igniteSent) != ECODE_OK;
+}
+
+/* a try that timed out on TX counts too, the answer timeout sends the next one */
+void igniteSent(ECODE status) {
+    igniteTries++;
+    igniteAnswerPending = 1;
+    igniteSentAt = tca_millis();
+    if (status != ECODE_OK) {
+        uart_tx("IGNITE not sent, TX timed out\r\n");
+        return;
+    }
+    if (!CONSOLE_VERBOSE) return;
+    char sentStr[48];
+    sprintf(sentStr, "Sent IGNITE to %02x (%u SPI bytes)\r\n", igniteFrame.pads, lora_last_tx_spi_bytes());
+    uart_tx(sentStr);
+}
+
+/* from IGNITE off air until its answers are in: the relay pulse, an answer slot per pad,
+   and the last pad getting back to receive */
+uint16_t igniteAnswerMs() {
+    uint8_t answers = proto_pad_count(igniteFrame.pads);
+    return PROTO_RELAY_MS + answers * proto_slot_us(adr_rate()) / 1000 + PROTO_POLL_GUARD_MS;
+}
+
+/* answers missing: try again while tries and time are left and ARM is still held, else give up */
+void igniteTimedOut() {
+    igniteAnswerPending = 0;
+    if (igniteTries < PROTO_IGNITE_TRIES && tca_millis_since(igniteStartAt) < PROTO_IGNITE_BUDGET_MS
+            && button_pressed(BUTTON_ARM)) {
+        igniteRetries++;
+        if (CONSOLE_VERBOSE) uart_tx("IGNITE not answered, sending again\r\n");
+        sendIgnite();
+        return;
     }
+    igniteActive = 0;
+    igniteUnanswered = 1;
+    char failStr[56];
+    sprintf(failStr, "IGNITE not answered by %02x after %u tries\r\n", ignitePads & ~igniteDone, igniteTries);
+    uart_tx(failStr);
+}
+
+/* close the last heartbeat and poll the next window of pads - every second */
+void heartbeatTask() {
+    beatDeferred = 0;
+    /* skip the beat while IGNITE is being sent, or answers to the last beat are still
+       due, it would talk over them, and right after IGNITE's answer, the pad is not
+       back in receive yet */
+    if (igniteActive || answerExpected()) return;
+    if (igniteDone && tca_millis_since(igniteAnswerAt) < PROTO_POLL_GUARD_MS) return;
+    /* the beat and its answers are on the working channel */
+    chan_return();
+    closeBeat();
     receivedGood = 0;
+    ratePending = 0;
+    pollPending = 0;
     PORTC.OUT &= ~LORA_LED_PIN;
-    ledMillis = millis;
-    /* The interrupt flag has to be cleared manually */
-    TCA0.SINGLE.INTFLAGS &= TCA_SINGLE_OVF_bm;
-}
\ No newline at end of file
+    ledMillis = tca_millis();
+
+    /* listen before talk, radioTask runs the beat again until the channel is clear */
+    if (!chan_clear()) {
+        beatDeferred = 1;
+        return;
+    }
+
+    /* a rate or channel change rides on the heartbeat, the pads answer RATE with STATUS.
+       A pad that is down would miss a move and the rest would come back, so only with all up */
+    proto_frame_t frame;
+    uint8_t message[PROTO_MAX_FRAME];
+    uint8_t rateChange = adr_propose(&newRate, &newPower);
+    uint8_t channelChange = pad_up(pad_fitted()) && chan_propose(&newChannel);
+    if (rateChange || channelChange) {
+        if (!rateChange) {
+            newRate = adr_rate();
+            newPower = adr_power();
+        }
+        if (!channelChange) newChannel = adr_channel();
+        initFrame(&frame, PROTO_OP_RATE);
+        frame.rate = newRate;
+        frame.power = newPower;
+        frame.channel = newChannel;
+        /* every pad has to take the change, the next beat waits for all the answers */
+        frame.pads = pad_fitted();
+    } else {
+        initFrame(&frame, PROTO_OP_PING);
+        frame.pads = pad_window(beatSlots());
+    }
+    uint8_t len = proto_encode(&frame, message);
+    selectPreamble(frame.pads);
+    /* skip this beat if an ignite is still on air */
+    if (lora_send_async(message, len, heartbeatSent) == ECODE_OK) {
+        ratePending = frame.op == PROTO_OP_RATE;
+        pollPending = fastPoll;
+        beatSeq = frame.seq;
+        beatPads = frame.pads;
+        beatAnswered = 0;
+        beatOpen = 1;
+        /* without PROTO_FLAG_POLL the pads go back to sleep after answering */
+        if (!fastPoll) pad_sleep();
+        lastBeatAt = tca_millis();
+        if (CONSOLE_VERBOSE) uart_tx(ratePending ? "Sent RATE\r\n" : "Sent PING\r\n");
+    }
+    if (fastPoll) {
+        sched_set_period(heartbeatTaskId, pollPeriod(frame.pads));
+    }
+}
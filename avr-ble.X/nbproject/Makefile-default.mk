@@ -51,17 +51,17 @@ OBJECTDIR=build/${CND_CONF}/${IMAGE_TYPE}
 DISTDIR=dist/${CND_CONF}/${IMAGE_TYPE}
 
 # Source Files Quoted if spaced
-SOURCEFILES_QUOTED_IF_SPACED=lora.c main.c spi.c uart.c tca.c
+SOURCEFILES_QUOTED_IF_SPACED=lora.c main.c spi.c uart.c tca.c sched.c toa.c hal_avr.c adr.c trace.c button.c pad.c chan.c telem.c afc.c
 
 # Object Files Quoted if spaced
-OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/lora.o ${OBJECTDIR}/main.o ${OBJECTDIR}/spi.o ${OBJECTDIR}/uart.o ${OBJECTDIR}/tca.o
-POSSIBLE_DEPFILES=${OBJECTDIR}/lora.o.d ${OBJECTDIR}/main.o.d ${OBJECTDIR}/spi.o.d ${OBJECTDIR}/uart.o.d ${OBJECTDIR}/tca.o.d
+OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/lora.o ${OBJECTDIR}/main.o ${OBJECTDIR}/spi.o ${OBJECTDIR}/uart.o ${OBJECTDIR}/tca.o ${OBJECTDIR}/sched.o ${OBJECTDIR}/toa.o ${OBJECTDIR}/hal_avr.o ${OBJECTDIR}/adr.o ${OBJECTDIR}/trace.o ${OBJECTDIR}/button.o ${OBJECTDIR}/pad.o ${OBJECTDIR}/chan.o ${OBJECTDIR}/telem.o ${OBJECTDIR}/afc.o
+POSSIBLE_DEPFILES=${OBJECTDIR}/lora.o.d ${OBJECTDIR}/main.o.d ${OBJECTDIR}/spi.o.d ${OBJECTDIR}/uart.o.d ${OBJECTDIR}/tca.o.d ${OBJECTDIR}/sched.o.d ${OBJECTDIR}/toa.o.d ${OBJECTDIR}/hal_avr.o.d ${OBJECTDIR}/adr.o.d ${OBJECTDIR}/trace.o.d ${OBJECTDIR}/button.o.d ${OBJECTDIR}/pad.o.d ${OBJECTDIR}/chan.o.d ${OBJECTDIR}/telem.o.d ${OBJECTDIR}/afc.o.d
 
 # Object Files
-OBJECTFILES=${OBJECTDIR}/lora.o ${OBJECTDIR}/main.o ${OBJECTDIR}/spi.o ${OBJECTDIR}/uart.o ${OBJECTDIR}/tca.o
+OBJECTFILES=${OBJECTDIR}/lora.o ${OBJECTDIR}/main.o ${OBJECTDIR}/spi.o ${OBJECTDIR}/uart.o ${OBJECTDIR}/tca.o ${OBJECTDIR}/sched.o ${OBJECTDIR}/toa.o ${OBJECTDIR}/hal_avr.o ${OBJECTDIR}/adr.o ${OBJECTDIR}/trace.o ${OBJECTDIR}/button.o ${OBJECTDIR}/pad.o ${OBJECTDIR}/chan.o ${OBJECTDIR}/telem.o ${OBJECTDIR}/afc.o
 
 # Source Files
-SOURCEFILES=lora.c main.c spi.c uart.c tca.c
+SOURCEFILES=lora.c main.c spi.c uart.c tca.c sched.c toa.c hal_avr.c adr.c trace.c button.c pad.c chan.c telem.c afc.c
 
 
 
@@ -117,6 +117,56 @@ ${OBJECTDIR}/tca.o: tca.c  .generated_files/flags/default/652da512bf8f23cfdeb1dd
 	@${RM} ${OBJECTDIR}/tca.o.d 
 	@${RM} ${OBJECTDIR}/tca.o 
 	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -D__DEBUG=1 -g -DDEBUG  -gdwarf-2  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/tca.o.d" -MT "${OBJECTDIR}/tca.o.d" -MT ${OBJECTDIR}/tca.o -o ${OBJECTDIR}/tca.o tca.c 
+${OBJECTDIR}/afc.o: afc.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/afc.o.d 
+	@${RM} ${OBJECTDIR}/afc.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -D__DEBUG=1 -g -DDEBUG  -gdwarf-2  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/afc.o.d" -MT "${OBJECTDIR}/afc.o.d" -MT ${OBJECTDIR}/afc.o -o ${OBJECTDIR}/afc.o afc.c 
+${OBJECTDIR}/telem.o: telem.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/telem.o.d 
+	@${RM} ${OBJECTDIR}/telem.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -D__DEBUG=1 -g -DDEBUG  -gdwarf-2  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/telem.o.d" -MT "${OBJECTDIR}/telem.o.d" -MT ${OBJECTDIR}/telem.o -o ${OBJECTDIR}/telem.o telem.c 
+${OBJECTDIR}/chan.o: chan.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/chan.o.d 
+	@${RM} ${OBJECTDIR}/chan.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -D__DEBUG=1 -g -DDEBUG  -gdwarf-2  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/chan.o.d" -MT "${OBJECTDIR}/chan.o.d" -MT ${OBJECTDIR}/chan.o -o ${OBJECTDIR}/chan.o chan.c 
+${OBJECTDIR}/pad.o: pad.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/pad.o.d 
+	@${RM} ${OBJECTDIR}/pad.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -D__DEBUG=1 -g -DDEBUG  -gdwarf-2  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/pad.o.d" -MT "${OBJECTDIR}/pad.o.d" -MT ${OBJECTDIR}/pad.o -o ${OBJECTDIR}/pad.o pad.c 
+${OBJECTDIR}/button.o: button.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/button.o.d 
+	@${RM} ${OBJECTDIR}/button.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -D__DEBUG=1 -g -DDEBUG  -gdwarf-2  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/button.o.d" -MT "${OBJECTDIR}/button.o.d" -MT ${OBJECTDIR}/button.o -o ${OBJECTDIR}/button.o button.c 
+${OBJECTDIR}/trace.o: trace.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/trace.o.d 
+	@${RM} ${OBJECTDIR}/trace.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -D__DEBUG=1 -g -DDEBUG  -gdwarf-2  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/trace.o.d" -MT "${OBJECTDIR}/trace.o.d" -MT ${OBJECTDIR}/trace.o -o ${OBJECTDIR}/trace.o trace.c 
+${OBJECTDIR}/adr.o: adr.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/adr.o.d 
+	@${RM} ${OBJECTDIR}/adr.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -D__DEBUG=1 -g -DDEBUG  -gdwarf-2  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/adr.o.d" -MT "${OBJECTDIR}/adr.o.d" -MT ${OBJECTDIR}/adr.o -o ${OBJECTDIR}/adr.o adr.c 
+${OBJECTDIR}/hal_avr.o: hal_avr.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/hal_avr.o.d 
+	@${RM} ${OBJECTDIR}/hal_avr.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -D__DEBUG=1 -g -DDEBUG  -gdwarf-2  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/hal_avr.o.d" -MT "${OBJECTDIR}/hal_avr.o.d" -MT ${OBJECTDIR}/hal_avr.o -o ${OBJECTDIR}/hal_avr.o hal_avr.c 
+${OBJECTDIR}/toa.o: toa.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/toa.o.d 
+	@${RM} ${OBJECTDIR}/toa.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -D__DEBUG=1 -g -DDEBUG  -gdwarf-2  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/toa.o.d" -MT "${OBJECTDIR}/toa.o.d" -MT ${OBJECTDIR}/toa.o -o ${OBJECTDIR}/toa.o toa.c 
+${OBJECTDIR}/sched.o: sched.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/sched.o.d 
+	@${RM} ${OBJECTDIR}/sched.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -D__DEBUG=1 -g -DDEBUG  -gdwarf-2  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/sched.o.d" -MT "${OBJECTDIR}/sched.o.d" -MT ${OBJECTDIR}/sched.o -o ${OBJECTDIR}/sched.o sched.c 
 	
 else
 ${OBJECTDIR}/lora.o: lora.c  .generated_files/flags/default/e2f91b69503dd1df16058471068a17089d0675d .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
@@ -148,6 +198,56 @@ ${OBJECTDIR}/tca.o: tca.c  .generated_files/flags/default/2792fb703d41f1d8c18c37
 	@${RM} ${OBJECTDIR}/tca.o.d 
 	@${RM} ${OBJECTDIR}/tca.o 
 	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/tca.o.d" -MT "${OBJECTDIR}/tca.o.d" -MT ${OBJECTDIR}/tca.o -o ${OBJECTDIR}/tca.o tca.c 
+${OBJECTDIR}/afc.o: afc.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/afc.o.d 
+	@${RM} ${OBJECTDIR}/afc.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/afc.o.d" -MT "${OBJECTDIR}/afc.o.d" -MT ${OBJECTDIR}/afc.o -o ${OBJECTDIR}/afc.o afc.c 
+${OBJECTDIR}/telem.o: telem.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/telem.o.d 
+	@${RM} ${OBJECTDIR}/telem.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/telem.o.d" -MT "${OBJECTDIR}/telem.o.d" -MT ${OBJECTDIR}/telem.o -o ${OBJECTDIR}/telem.o telem.c 
+${OBJECTDIR}/chan.o: chan.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/chan.o.d 
+	@${RM} ${OBJECTDIR}/chan.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/chan.o.d" -MT "${OBJECTDIR}/chan.o.d" -MT ${OBJECTDIR}/chan.o -o ${OBJECTDIR}/chan.o chan.c 
+${OBJECTDIR}/pad.o: pad.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/pad.o.d 
+	@${RM} ${OBJECTDIR}/pad.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/pad.o.d" -MT "${OBJECTDIR}/pad.o.d" -MT ${OBJECTDIR}/pad.o -o ${OBJECTDIR}/pad.o pad.c 
+${OBJECTDIR}/button.o: button.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/button.o.d 
+	@${RM} ${OBJECTDIR}/button.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/button.o.d" -MT "${OBJECTDIR}/button.o.d" -MT ${OBJECTDIR}/button.o -o ${OBJECTDIR}/button.o button.c 
+${OBJECTDIR}/trace.o: trace.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/trace.o.d 
+	@${RM} ${OBJECTDIR}/trace.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/trace.o.d" -MT "${OBJECTDIR}/trace.o.d" -MT ${OBJECTDIR}/trace.o -o ${OBJECTDIR}/trace.o trace.c 
+${OBJECTDIR}/adr.o: adr.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/adr.o.d 
+	@${RM} ${OBJECTDIR}/adr.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/adr.o.d" -MT "${OBJECTDIR}/adr.o.d" -MT ${OBJECTDIR}/adr.o -o ${OBJECTDIR}/adr.o adr.c 
+${OBJECTDIR}/hal_avr.o: hal_avr.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/hal_avr.o.d 
+	@${RM} ${OBJECTDIR}/hal_avr.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/hal_avr.o.d" -MT "${OBJECTDIR}/hal_avr.o.d" -MT ${OBJECTDIR}/hal_avr.o -o ${OBJECTDIR}/hal_avr.o hal_avr.c 
+${OBJECTDIR}/toa.o: toa.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/toa.o.d 
+	@${RM} ${OBJECTDIR}/toa.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/toa.o.d" -MT "${OBJECTDIR}/toa.o.d" -MT ${OBJECTDIR}/toa.o -o ${OBJECTDIR}/toa.o toa.c 
+${OBJECTDIR}/sched.o: sched.c  .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/sched.o.d 
+	@${RM} ${OBJECTDIR}/sched.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE) -mcpu=$(MP_PROCESSOR_OPTION) -c  -x c -D__$(MP_PROCESSOR_OPTION)__   -mdfp="${DFP_DIR}/xc8"  -Wl,--gc-sections -O1 -ffunction-sections -fdata-sections -fshort-enums -fno-common -funsigned-char -funsigned-bitfields -Wall -DXPRJ_default=$(CND_CONF)  $(COMPARISON_BUILD)  -gdwarf-3 -mno-const-data-in-progmem     -MD -MP -MF "${OBJECTDIR}/sched.o.d" -MT "${OBJECTDIR}/sched.o.d" -MT ${OBJECTDIR}/sched.o -o ${OBJECTDIR}/sched.o sched.c 
 	
 endif
 
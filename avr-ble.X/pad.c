@@ -0,0 +1,144 @@
+#include "clock.h"
+
+#include "pad.h"
+#include "proto.h"
+#include "tca.h"
+
+static pad_t pads[PROTO_PAD_MAX];
+static uint8_t fitted;
+static uint8_t next; // index the next window starts looking from
+
+void pad_init(uint8_t mask) {
+    fitted = mask;
+    next = 0;
+    for (uint8_t i = 0; i < PROTO_PAD_MAX; i++) {
+        pads[i] = (pad_t) {0};
+    }
+}
+
+uint8_t pad_fitted() {
+    return fitted;
+}
+
+uint8_t pad_slots(uint8_t rate, uint16_t preamble, uint16_t period_ms) {
+    uint32_t command_us = proto_frame_us(rate, preamble);
+    uint32_t period_us = period_ms * 1000UL;
+    if (command_us >= period_us) return 1;
+    uint32_t slots = (period_us - command_us) / proto_slot_us(rate);
+    uint8_t count = proto_pad_count(fitted);
+    if (slots < 1) return 1;
+    if (count > 0 && slots > count) return count;
+    return slots;
+}
+
+uint8_t pad_window(uint8_t slots) {
+    uint8_t window = 0;
+    for (uint8_t n = 0; n < PROTO_PAD_MAX && slots > 0; n++) {
+        uint8_t bit = 1 << next;
+        next = (next + 1) % PROTO_PAD_MAX;
+        if (fitted & bit) {
+            window |= bit;
+            slots--;
+        }
+    }
+    return window;
+}
+
+/* a round of windows, then the command on air and the last answer slot */
+uint32_t pad_bound_ms(uint8_t rate, uint16_t preamble, uint16_t period_ms) {
+    uint8_t slots = pad_slots(rate, preamble, period_ms);
+    uint8_t count = proto_pad_count(fitted);
+    uint32_t cycle_ms = (uint32_t) ((count + slots - 1) / slots) * period_ms;
+    return cycle_ms + (proto_frame_us(rate, preamble) + slots * proto_slot_us(rate)) / 1000;
+}
+
+void pad_status(uint8_t id, uint8_t status, int8_t signal) {
+    if (!proto_pad_bit(id)) return;
+    pad_t *pad = &pads[id - 1];
+    uint32_t age = tca_millis_since(pad->heard_at);
+    if (pad->heard && age > pad->age_max_ms) pad->age_max_ms = age;
+    pad->up = 1;
+    pad->status = status;
+    pad->signal = signal;
+    pad->misses = 0;
+    pad->heard = 1;
+    pad->heard_at = tca_millis();
+}
+
+uint8_t pad_polled(uint8_t polled, uint8_t answered) {
+    uint8_t lost = 0;
+    for (uint8_t i = 0; i < PROTO_PAD_MAX; i++) {
+        uint8_t bit = 1 << i;
+        if (!(polled & bit) || (answered & bit)) continue;
+        pad_t *pad = &pads[i];
+        pad->up = 0;
+        if (pad->misses < 0xFF) pad->misses++;
+        if (pad->heard && pad->misses == PAD_LOST_MISSES) lost |= bit;
+    }
+    return lost;
+}
+
+uint8_t pad_up(uint8_t mask) {
+    for (uint8_t i = 0; i < PROTO_PAD_MAX; i++) {
+        if ((mask & (1 << i)) && !pads[i].up) return 0;
+    }
+    return 1;
+}
+
+uint8_t pad_continuity(uint8_t mask) {
+    for (uint8_t i = 0; i < PROTO_PAD_MAX; i++) {
+        if ((mask & (1 << i)) && !(pads[i].status & PROTO_STATUS_CONTINUITY)) return 0;
+    }
+    return 1;
+}
+
+void pad_wake(uint8_t mask) {
+    uint32_t now = tca_millis();
+    for (uint8_t i = 0; i < PROTO_PAD_MAX; i++) {
+        if (!(mask & (1 << i))) continue;
+        pads[i].awake = 1;
+        pads[i].awake_at = now;
+    }
+}
+
+void pad_sleep() {
+    for (uint8_t i = 0; i < PROTO_PAD_MAX; i++) {
+        pads[i].awake = 0;
+    }
+}
+
+uint8_t pad_awake(uint8_t mask, uint16_t ms) {
+    for (uint8_t i = 0; i < PROTO_PAD_MAX; i++) {
+        if (!(mask & (1 << i))) continue;
+        if (!pads[i].awake || tca_millis_since(pads[i].awake_at) >= ms) return 0;
+    }
+    return 1;
+}
+
+const pad_t *pad_get(uint8_t id) {
+    if (!proto_pad_bit(id)) return 0;
+    return &pads[id - 1];
+}
+
+/* a pad gone quiet counts with the time since it was last heard */
+uint8_t pad_worst(uint32_t *age_ms) {
+    uint8_t worst = 0;
+    *age_ms = 0;
+    for (uint8_t i = 0; i < PROTO_PAD_MAX; i++) {
+        pad_t *pad = &pads[i];
+        if (!(fitted & (1 << i)) || !pad->heard) continue;
+        uint32_t age = tca_millis_since(pad->heard_at);
+        if (pad->age_max_ms > age) age = pad->age_max_ms;
+        if (worst == 0 || age > *age_ms) {
+            worst = i + 1;
+            *age_ms = age;
+        }
+    }
+    return worst;
+}
+
+void pad_clear_stats() {
+    for (uint8_t i = 0; i < PROTO_PAD_MAX; i++) {
+        pads[i].age_max_ms = 0;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef __PAD_H_
+#define __PAD_H_
+
+#include "ecode.h"
+
+/*
+Pad table: what the controller knows about each receiver
+
+Pads are numbered 1 to PROTO_PAD_MAX and addressed with masks (proto.h).
+Each heartbeat polls a window of the fitted pads: as many as there are
+answer slots in the heartbeat period after the command at the current
+rate, the next ones in number order after the last window, round and
+round. A pad's STATUS is so at most pad_bound_ms() old unless answers go
+missing; pad_worst() tells how old it has got.
+
+A pad is up while it answers: one poll unanswered and it is down, shown as
+no connection. PAD_LOST_MISSES polls unanswered in a row and it is lost,
+it may have fallen back to the robust rate on its own.
+*/
+
+#define PAD_LOST_MISSES     3
+
+typedef struct {
+    uint8_t up;             // answered its last poll, or notified since
+    uint8_t status;         // status byte of the last STATUS
+    int8_t signal;          // strength of the command it answered, as it heard it
+    uint8_t misses;         // polls unanswered in a row
+    uint8_t heard;          // has answered since power-up
+    uint32_t heard_at;      // tca_millis() of the last STATUS
+    uint32_t age_max_ms;    // longest gap between two STATUS since pad_clear_stats()
+    uint8_t awake;          // answered a fast poll at awake_at, listens without waking
+    uint32_t awake_at;
+} pad_t;
+
+// Set the fitted pads, a mask of pad numbers. All start down
+void pad_init(uint8_t fitted);
+uint8_t pad_fitted();
+
+// Answer slots that fit in 'period_ms' after a command with 'preamble' symbols at 'rate', 1 to the fitted pads
+uint8_t pad_slots(uint8_t rate, uint16_t preamble, uint16_t period_ms);
+
+// Pads to poll next: up to 'slots' fitted pads after the last window
+uint8_t pad_window(uint8_t slots);
+
+// Longest between two STATUS from a pad polled every 'period_ms' with 'preamble' symbol commands at 'rate'
+uint32_t pad_bound_ms(uint8_t rate, uint16_t preamble, uint16_t period_ms);
+
+// STATUS from pad 'id', an answer or a notification
+void pad_status(uint8_t id, uint8_t status, int8_t signal);
+
+// A poll of 'polled' is over, 'answered' of them answered. Returns the pads it lost
+uint8_t pad_polled(uint8_t polled, uint8_t answered);
+
+// 1 if every pad in 'pads' is up
+uint8_t pad_up(uint8_t pads);
+// 1 if every pad in 'pads' reported continuity last
+uint8_t pad_continuity(uint8_t pads);
+
+// Fast poll: 'pads' answered one just now and listen for PROTO_POLL_AWAKE_MS
+void pad_wake(uint8_t pads);
+// A command without PROTO_FLAG_POLL went out, every pad goes back to sleep after it
+void pad_sleep();
+// 1 if every pad in 'pads' answered a fast poll less than 'ms' ago
+uint8_t pad_awake(uint8_t pads, uint16_t ms);
+
+// Entry of pad 'id', 0 if it is no pad number
+const pad_t *pad_get(uint8_t id);
+
+// Fitted pad whose STATUS got oldest since pad_clear_stats(), 0 if none has answered; fills 'age_ms'
+uint8_t pad_worst(uint32_t *age_ms);
+void pad_clear_stats();
+
+#endif /* __PAD_H_ */
@@ -0,0 +1,103 @@
+#include "clock.h"
+
+#include "sched.h"
+#include "hal.h"
+#include "tca.h"
+#include "uart.h"
+
+#include <stdio.h>
+
+typedef struct {
+    const char *name;
+    sched_task_fn fn;
+    uint16_t period;
+    uint16_t countdown;
+    volatile uint8_t due;
+    volatile uint32_t due_at; // tca_micros() when the task became due
+    uint16_t worst_us;
+    uint16_t worst_late_us;
+} sched_task_t;
+
+static sched_task_t tasks[SCHED_MAX_TASKS];
+static uint8_t task_count;
+
+ECODE sched_add(const char *name, sched_task_fn fn, uint16_t period, uint8_t *id) {
+    if (task_count >= SCHED_MAX_TASKS || fn == 0) return ECODE_FAIL;
+    sched_task_t *task = &tasks[task_count];
+    task->name = name;
+    task->fn = fn;
+    task->period = period;
+    task->countdown = period;
+    task->due = 0;
+    *id = task_count;
+    task_count++;
+    return ECODE_OK;
+}
+
+ECODE sched_set_period(uint8_t id, uint16_t period) {
+    if (id >= task_count || tasks[id].period == 0 || period == 0) return ECODE_FAIL;
+    uint8_t sreg = hal_irq_save();
+    tasks[id].period = period;
+    if (tasks[id].countdown > period) tasks[id].countdown = period;
+    hal_irq_restore(sreg);
+    return ECODE_OK;
+}
+
+void sched_post(uint8_t id) {
+    if (id >= task_count || tasks[id].due) return;
+    tasks[id].due_at = tca_micros();
+    tasks[id].due = 1;
+}
+
+void sched_tick() {
+    for (uint8_t i = 0; i < task_count; i++) {
+        sched_task_t *task = &tasks[i];
+        if (task->period == 0) continue;
+        if (--task->countdown == 0) {
+            task->countdown = task->period;
+            sched_post(i);
+        }
+    }
+}
+
+void sched_run() {
+    for (uint8_t i = 0; i < task_count; i++) {
+        sched_task_t *task = &tasks[i];
+        if (!task->due) continue;
+        uint32_t start = tca_micros();
+        uint32_t late = start - task->due_at;
+        task->due = 0;
+        task->fn();
+        uint32_t elapsed = tca_micros() - start;
+        /* saturate, anything above 65 ms is a bug anyway */
+        if (elapsed > 0xFFFF) elapsed = 0xFFFF;
+        if (late > 0xFFFF) late = 0xFFFF;
+        if (elapsed > task->worst_us) task->worst_us = elapsed;
+        if (late > task->worst_late_us) task->worst_late_us = late;
+    }
+}
+
+uint16_t sched_worst_us(uint8_t id) {
+    if (id >= task_count) return 0;
+    return tasks[id].worst_us;
+}
+
+uint16_t sched_worst_late_us(uint8_t id) {
+    if (id >= task_count) return 0;
+    return tasks[id].worst_late_us;
+}
+
+void sched_reset_stats() {
+    for (uint8_t i = 0; i < task_count; i++) {
+        tasks[i].worst_us = 0;
+        tasks[i].worst_late_us = 0;
+    }
+}
+
+void sched_report() {
+    char line[48];
+    for (uint8_t i = 0; i < task_count; i++) {
+        sprintf(line, "%s: run %u us, late %u us\r\n", tasks[i].name, tasks[i].worst_us, tasks[i].worst_late_us);
+        uart_tx(line);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef __SCHED_H_
+#define __SCHED_H_
+
+#include "ecode.h"
+
+/*
+Cooperative task scheduler
+
+Tasks run to completion from sched_run() in the main loop, never from an
+interrupt. Periodic tasks are made due by sched_tick() from the 1 ms timer
+interrupt, any task can be made due immediately with sched_post().
+Every task's run time is measured so the worst case blocking any other task
+(e.g. the button scan that sends IGNITE) can be read back at runtime.
+*/
+
+#define SCHED_MAX_TASKS     8
+
+typedef void (*sched_task_fn)(void);
+
+// Add a task that becomes due every 'period' ms (0 = only when posted)
+ECODE sched_add(const char *name, sched_task_fn fn, uint16_t period, uint8_t *id);
+
+// Change the period of a periodic task. The next run comes at the latest 'period' ms from now
+ECODE sched_set_period(uint8_t id, uint16_t period);
+
+// Make a task due on the next pass of sched_run(). Safe to call from an interrupt
+void sched_post(uint8_t id);
+
+// Advance periodic tasks by one millisecond. Call from the tick interrupt
+void sched_tick();
+
+// Run every due task once. This should run in non-blocked main loop
+void sched_run();
+
+// Longest single run of a task, in microseconds
+uint16_t sched_worst_us(uint8_t id);
+
+// Longest time a task waited past becoming due, in microseconds
+uint16_t sched_worst_late_us(uint8_t id);
+
+// Clear the run time statistics of all tasks
+void sched_reset_stats();
+
+// Print name and worst run/late time of every task over UART
+void sched_report();
+
+#endif /* __SCHED_H_ */
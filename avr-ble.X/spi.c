@@ -1,48 +1,143 @@
-#define F_CPU 3333333
+#include "clock.h"
+#define SPI_QUEUE_MASK (SPI_QUEUE - 1)
 
 #include "spi.h"
+#include "tca.h"
+
+typedef struct {
+    uint8_t command;
+    const uint8_t *output;
+    uint8_t *input;
+    uint8_t len;
+    void (*callback)(ECODE status);
+} spi_job_t;
+
+// Bytes clocked since the last spi_reset_byte_count(), used to measure driver cost
+static uint32_t spi_bytes;
+
+static spi_job_t queue[SPI_QUEUE];
+static volatile uint8_t head; // the transaction on the bus
+static volatile uint8_t count;
+static volatile uint16_t finished; // transactions done, for spi_flush() to tell them apart
+// Bytes of the one on the bus written and read, the command byte included
+static uint16_t sent;
+static volatile uint16_t received;
 
 ECODE spi_init() {
-    PORTA.DIR |= MOSI_PIN; /* Set MOSI pin direction to output */
-    PORTA.DIR &= ~MISO_PIN; /* Set MISO pin direction to input */
-    PORTA.DIR |= CLK_PIN; /* Set SCK pin direction to output */
-    PORTA.DIR |= CS_PIN; /* Set CS pin direction to output */
-    SPI0.CTRLA = SPI_CLK2X_bm /* Enable double-speed */ /* MSB is transmitted first */
-    | SPI_ENABLE_bm /* Enable module */
-    | SPI_MASTER_bm /* SPI module in Host mode */
-    | SPI_PRESC_DIV4_gc; /* System Clock divided by 4 (0.8333 MHz) */
-    SPI0.CTRLB |= SPI_MODE_0_gc; /* Data Mode 3 */
-    // SPCR = 0b01010000;
+    hal_spi_init();
+    hal_spi_select(0);
     return ECODE_OK;
 }
 
-void spi_enable() {
-    PORTA.OUT &= ~CS_PIN; // Set CS pin value to LOW
+ECODE spi_transaction(uint8_t command, const uint8_t *output, uint8_t *input, uint8_t len) {
+    spi_flush();
+    hal_spi_select(1);
+    ECODE status = hal_spi_transfer(command, output, input, len);
+    hal_spi_select(0);
+    spi_bytes += len + 1;
+    return status;
 }
 
-void spi_disable() {
-    PORTA.OUT |= CS_PIN; // Set CS pin value to HIGH
+static void feed() {
+    spi_job_t *job = &queue[head];
+    /* at most two in flight, one shifting and one in the transmit buffer, so the two byte
+       receive buffer cannot overflow */
+    while (sent <= job->len && sent - received < 2 && hal_spi_tx_ready()) {
+        hal_spi_write(sent == 0 ? job->command : (job->output ? job->output[sent - 1] : 0));
+        sent++;
+    }
 }
 
-ECODE spi_tx(uint8_t input) {
-    uint8_t dummy;
-    return spi_txrx(input, &dummy);
+static void start() {
+    sent = 0;
+    received = 0;
+    hal_spi_select(1);
+    feed();
 }
 
-ECODE spi_rx(uint8_t *output) {
-    uint8_t dummy = 0;
-    return spi_txrx(dummy, output);
+static void finish(ECODE status) {
+    void (*callback)(ECODE status) = queue[head].callback;
+    hal_spi_select(0);
+    /* a byte left over from a transaction that timed out */
+    while (hal_spi_rx_ready()) hal_spi_read();
+    head = (head + 1) & SPI_QUEUE_MASK;
+    count--;
+    finished++;
+    if (count) {
+        start();
+    } else {
+        hal_spi_irq(0);
+    }
+    if (callback) callback(status);
 }
 
-ECODE spi_txrx(uint8_t input, uint8_t *output) {
-    SPI0.DATA = input;
-    uint16_t attempts = 0;
-    while (!(SPI0.INTFLAGS & SPI_IF_bm)) {
-        if (attempts > 1000) {
-            return ECODE_FAIL;
-        }
-        attempts++;
+void spi_isr() {
+    if (!count) {
+        while (hal_spi_rx_ready()) hal_spi_read();
+        return;
+    }
+    spi_job_t *job = &queue[head];
+    while (hal_spi_rx_ready()) {
+        uint8_t in = hal_spi_read();
+        if (received > 0 && job->input) job->input[received - 1] = in;
+        received++;
+    }
+    if (received > job->len) {
+        finish(ECODE_OK);
+    } else {
+        feed();
+    }
+}
+
+ECODE spi_queue(uint8_t command, const uint8_t *output, uint8_t *input, uint8_t len,
+        void (*callback)(ECODE status)) {
+    uint8_t sreg = hal_irq_save();
+    if (count == SPI_QUEUE) {
+        hal_irq_restore(sreg);
+        return ECODE_FAIL;
+    }
+    queue[(head + count) & SPI_QUEUE_MASK] = (spi_job_t) {command, output, input, len, callback};
+    spi_bytes += len + 1;
+    if (count++ == 0) {
+        start();
+        hal_spi_irq(1);
     }
-    *output = SPI0.DATA;
+    hal_irq_restore(sreg);
     return ECODE_OK;
-}
\ No newline at end of file
+}
+
+uint8_t spi_busy() {
+    return count;
+}
+
+void spi_flush() {
+    uint16_t job = 0;
+    uint16_t seen = 0;
+    uint32_t seenAt = 0;
+    uint8_t watching = 0;
+    while (count) {
+        uint8_t sreg = hal_irq_save();
+        /* clock the queue by hand in case interrupts are off, as uart_flush() does */
+        spi_isr();
+        if (count) {
+            if (!watching || finished != job || received != seen) {
+                watching = 1;
+                job = finished;
+                seen = received;
+                seenAt = tca_micros();
+            } else if (tca_micros_since(seenAt) > SPI_TIMEOUT_US && !hal_spi_rx_ready()) {
+                finish(ECODE_FAIL);
+            }
+        }
+        hal_irq_restore(sreg);
+        if (count) hal_idle();
+    }
+}
+
+uint32_t spi_byte_count() {
+    return spi_bytes;
+}
+
+void spi_reset_byte_count() {
+    spi_bytes = 0;
+}
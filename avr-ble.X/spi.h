@@ -1,11 +1,21 @@
 #ifndef __SPI_H_
 #define __SPI_H_
 
-#include <avr/io.h>
-#include "ecode.h"
+#include "hal.h"
 
 /*
-SPI module
+SPI module, on top of the hal_spi_* functions
+
+Every access is one transaction: CS low, a command byte (for the SX127x
+the register address and the write bit), the data bytes, CS high. The
+HAL clocks them back to back, the next byte waiting in the transmit
+buffer while one shifts, so a burst costs little more than its SCK time.
+
+Transactions can also be queued with spi_queue(). The SPI interrupt then
+clocks them in the background, one after another, and runs each one's
+callback when it is done. spi_transaction() lets the queue run empty
+first, so the radio sees every access in the order it was made. Queue
+from the main loop only, the callbacks run in the interrupt.
 */
 
 #define CS_PIN     PIN7_bm
@@ -13,11 +23,29 @@ SPI module
 #define MOSI_PIN   PIN4_bm
 #define MISO_PIN   PIN5_bm
 
+// Set up SPI0 with CS high
 ECODE spi_init();
-void spi_enable();
-void spi_disable();
-ECODE spi_tx(uint8_t input);
-ECODE spi_rx(uint8_t *output);
-ECODE spi_txrx(uint8_t input, uint8_t *output);
+// 'command', then 'len' bytes out of 'output' (zeros if 0) and into 'input' (dropped if 0)
+ECODE spi_transaction(uint8_t command, const uint8_t *output, uint8_t *input, uint8_t len);
+
+// Transactions spi_queue() holds, a power of two
+#define SPI_QUEUE 8
+// A queued transaction gives up when no byte has come in for this long
+#define SPI_TIMEOUT_US 100
+// The same in the background. 'output' and 'input' have to stay valid until 'callback'
+// (may be 0) runs, with ECODE_FAIL if no byte came in for SPI_TIMEOUT_US while spi_flush()
+// waited on it. ECODE_FAIL at once if the queue is full
+ECODE spi_queue(uint8_t command, const uint8_t *output, uint8_t *input, uint8_t len,
+        void (*callback)(ECODE status));
+// Non-zero while queued transactions are left
+uint8_t spi_busy();
+// Wait for the queue to run empty, clocking it by hand if interrupts are off
+void spi_flush();
+// SPI interrupt, a byte came in
+void spi_isr();
+
+// Number of bytes clocked over SPI since the last reset
+uint32_t spi_byte_count();
+void spi_reset_byte_count();
 
 #endif
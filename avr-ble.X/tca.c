@@ -1,23 +1,57 @@
-#define F_CPU 3333333
+#include "clock.h"
 
 #include "tca.h"
-#include <avr/interrupt.h>
+#include "hal.h"
 
-ECODE tca_init() {
-    /* enable overflow interrupt */
-    TCA0.SINGLE.INTCTRL = TCA_SINGLE_OVF_bm;
+/* timer clocks per 1 ms tick (sys_clk/1) */
+#define TCA_TICK_PER CLOCK_TCA_PERIOD
 
-    /* set Normal mode */
-    TCA0.SINGLE.CTRLB = TCA_SINGLE_WGMODE_NORMAL_gc;
+static volatile uint32_t tca_ticks;
 
-    /* disable event counting */
-    TCA0.SINGLE.EVCTRL &= ~(TCA_SINGLE_CNTEI_bm);
+// Tick callback function pointer
+static void (*tca_tick_callback)(void);
 
-    /* set the period */
-    TCA0.SINGLE.PER = 13020; // one second
+void tca_tick_isr() {
+    tca_ticks++;
+    if (tca_tick_callback) tca_tick_callback();
+}
 
-    TCA0.SINGLE.CTRLA = TCA_SINGLE_CLKSEL_DIV256_gc /* set clock
-    source (sys_clk/256) */
-    | TCA_SINGLE_ENABLE_bm; /* start timer */
+ECODE tca_init() {
+    hal_tick_init(TCA_TICK_PER); // one millisecond
     return ECODE_OK;
+}
+
+uint32_t tca_millis() {
+    uint8_t sreg = hal_irq_save();
+    uint32_t ticks = tca_ticks;
+    hal_irq_restore(sreg);
+    return ticks;
+}
+
+uint32_t tca_micros() {
+    uint8_t sreg = hal_irq_save();
+    uint32_t ticks = tca_ticks;
+    uint16_t cnt = hal_tick_count();
+    /* counter wrapped after interrupts were disabled, ISR hasn't counted it yet */
+    if (hal_tick_overflow_pending() && cnt < TCA_TICK_PER / 2) {
+        ticks++;
+    }
+    hal_irq_restore(sreg);
+    return ticks * 1000 + (uint32_t) cnt * 1000 / (TCA_TICK_PER + 1);
+}
+
+uint32_t tca_millis_since(uint32_t since) {
+    return tca_millis() - since;
+}
+
+uint32_t tca_micros_since(uint32_t since) {
+    return tca_micros() - since;
+}
+
+uint8_t tca_after(uint32_t a, uint32_t b) {
+    return (int32_t) (a - b) > 0;
+}
+
+void register_tca_tick_callback(void (*callback)(void)) {
+    tca_tick_callback = callback;
 }
\ No newline at end of file
@@ -3,6 +3,36 @@
 
 #include "ecode.h"
 
+/*
+System timebase on TCA0
+
+tca_millis() and tca_micros() read the tick count and the timer counter
+together with interrupts off, so a reading is never torn by the tick
+interrupt. Both wrap around (micros after 71 minutes, millis after 49
+days); compare readings with the helpers below, which are right across
+the wrap as long as the times compared are less than half the range apart.
+*/
+
+// Start TCA0 as the 1 ms system tick
 ECODE tca_init();
 
+// Milliseconds since tca_init()
+uint32_t tca_millis();
+
+// Microseconds since tca_init(), resolution is one timer clock
+uint32_t tca_micros();
+
+// Time since 'since', an earlier tca_millis() / tca_micros() reading
+uint32_t tca_millis_since(uint32_t since);
+uint32_t tca_micros_since(uint32_t since);
+
+// 1 if reading 'a' is later than reading 'b' (both millis or both micros)
+uint8_t tca_after(uint32_t a, uint32_t b);
+
+// Register function to run from the tick interrupt every millisecond
+void register_tca_tick_callback(void (*callback)(void));
+
+// Tick interrupt handler, called from the HAL
+void tca_tick_isr();
+
 #endif /* __TCA_H_ */
@@ -0,0 +1,117 @@
+#include "clock.h"
+
+#include "telem.h"
+
+#define FREQ_ERROR_MAX  0x7FFFFFL
+
+static uint8_t *put16(uint8_t *p, uint16_t value) {
+    *p++ = value & 0xFF;
+    *p++ = value >> 8;
+    return p;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t value) {
+    p = put16(p, value & 0xFFFF);
+    return put16(p, value >> 16);
+}
+
+static uint8_t sum(const uint8_t *p, uint8_t len) {
+    uint8_t total = 0;
+    while (len--) total += *p++;
+    return total;
+}
+
+uint8_t telem_frame_rx(const telem_rx_t *rx, uint8_t *out) {
+    uint8_t record[TELEM_RX_LEN];
+    uint8_t *p = record;
+    *p++ = TELEM_RX;
+    p = put32(p, rx->at);
+    *p++ = rx->from;
+    *p++ = rx->op;
+    *p++ = rx->seq;
+    *p++ = rx->flags;
+    *p++ = rx->status;
+    *p++ = rx->signal;
+    p = put16(p, rx->rssi);
+    *p++ = rx->snr;
+    int32_t error = rx->freq_error;
+    if (error > FREQ_ERROR_MAX) error = FREQ_ERROR_MAX;
+    if (error < -FREQ_ERROR_MAX) error = -FREQ_ERROR_MAX;
+    p = put16(p, error & 0xFFFF);
+    *p++ = (error >> 16) & 0xFF;
+    p = put16(p, rx->afc);
+    *p++ = rx->missed;
+    *p++ = rx->overflow;
+    *p++ = rx->crc_errors;
+    *p = sum(record, TELEM_RX_LEN - 1);
+
+    out[0] = 0;
+    uint8_t len = 1 + telem_cobs_encode(record, TELEM_RX_LEN, out + 1);
+    out[len++] = 0;
+    return len;
+}
+
+uint8_t telem_parse_rx(const uint8_t *in, uint8_t len, telem_rx_t *rx) {
+    uint8_t record[TELEM_RX_LEN + 1];
+    if (len > sizeof(record)) return 0;
+    if (telem_cobs_decode(in, len, record) != TELEM_RX_LEN) return 0;
+    if (record[0] != TELEM_RX || record[TELEM_RX_LEN - 1] != sum(record, TELEM_RX_LEN - 1)) return 0;
+    const uint8_t *p = record + 1;
+    rx->at = (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+    p += 4;
+    rx->from = *p++;
+    rx->op = *p++;
+    rx->seq = *p++;
+    rx->flags = *p++;
+    rx->status = *p++;
+    rx->signal = (int8_t) *p++;
+    rx->rssi = (int16_t) (p[0] | (p[1] << 8));
+    p += 2;
+    rx->snr = (int8_t) *p++;
+    int32_t error = (int32_t) p[0] | ((int32_t) p[1] << 8) | ((int32_t) p[2] << 16);
+    /* 24 bit two's complement */
+    if (error & 0x800000L) error -= 0x1000000L;
+    rx->freq_error = error;
+    p += 3;
+    rx->afc = (int16_t) (p[0] | (p[1] << 8));
+    p += 2;
+    rx->missed = *p++;
+    rx->overflow = *p++;
+    rx->crc_errors = *p;
+    return 1;
+}
+
+uint8_t telem_cobs_encode(const uint8_t *in, uint8_t len, uint8_t *out) {
+    /* each block starts with its length plus one, it ends in a zero unless it is 254 long */
+    uint8_t code_at = 0;
+    uint8_t code = 1;
+    uint8_t n = 1;
+    for (uint8_t i = 0; i < len; i++) {
+        if (in[i] != 0) {
+            out[n++] = in[i];
+            code++;
+        }
+        if (in[i] == 0 || code == 0xFF) {
+            out[code_at] = code;
+            code_at = n++;
+            code = 1;
+        }
+    }
+    out[code_at] = code;
+    return n;
+}
+
+uint8_t telem_cobs_decode(const uint8_t *in, uint8_t len, uint8_t *out) {
+    uint8_t n = 0;
+    uint8_t i = 0;
+    while (i < len) {
+        uint8_t code = in[i++];
+        if (code == 0 || i + code - 1 > len) return 0;
+        for (uint8_t k = 1; k < code; k++) {
+            if (in[i] == 0) return 0;
+            out[n++] = in[i++];
+        }
+        if (code != 0xFF && i < len) out[n++] = 0;
+    }
+    return n;
+}
@@ -0,0 +1,67 @@
+#ifndef __TELEM_H_
+#define __TELEM_H_
+
+#include <stdint.h>
+
+/*
+Link telemetry: a binary record per received packet on the console UART
+
+Instead of two lines of text, parse_lora() sends each packet as a
+TELEM_RX record, TELEM_RX_LEN bytes little-endian with the sum of the
+ones before it last:
+
+     0  type        TELEM_RX
+     1  at          uint32  tca_micros() at RxDone
+     5  from        pad number
+     6  op, seq, flags, status as in the frame (proto.h)
+    10  signal      int8    how the pad heard the command, STATUS only
+    11  rssi        int16   dBm
+    13  snr         int8    dB
+    14  freq_error  int24   Hz, the pad's carrier above the nominal frequency
+    17  afc         int16   Hz, the controller's correction (afc.h)
+    19  missed, overflow, crc_errors
+                    low bytes of the receive counters (lora_rx_stats())
+    22  check
+
+On the wire a record is COBS encoded, so it holds no zero byte, with a
+zero on both sides. Text still goes out between records and never holds
+a zero either: reading the stream, a zero starts a record and the next one
+ends it. sim/telem_csv turns a capture of the console into CSV.
+*/
+
+#define TELEM_RX            0x01
+
+#define TELEM_RX_LEN        23
+// A record on the wire: COBS adds a byte in every 254, and the two zeros around it
+#define TELEM_FRAME_MAX     (TELEM_RX_LEN + TELEM_RX_LEN / 254 + 1 + 2)
+
+typedef struct {
+    uint32_t at;
+    uint8_t from;
+    uint8_t op;
+    uint8_t seq;
+    uint8_t flags;
+    uint8_t status;
+    int8_t signal;
+    int16_t rssi;
+    int8_t snr;
+    int32_t freq_error;     // within +/- 2^23
+    int16_t afc;
+    uint8_t missed;
+    uint8_t overflow;
+    uint8_t crc_errors;
+} telem_rx_t;
+
+// Record as it goes on the wire, zeros around it, into 'out' of TELEM_FRAME_MAX bytes. Returns its length
+uint8_t telem_frame_rx(const telem_rx_t *rx, uint8_t *out);
+
+// Record from the bytes between two zeros on the wire. 1 if it is a whole TELEM_RX record
+uint8_t telem_parse_rx(const uint8_t *in, uint8_t len, telem_rx_t *rx);
+
+// Consistent overhead byte stuffing: 'len' bytes, up to 252, to up to len + len / 254 + 1 with no
+// zero in them. Returns the encoded length
+uint8_t telem_cobs_encode(const uint8_t *in, uint8_t len, uint8_t *out);
+// And back, into 'out' of at least 'len' bytes. Returns the decoded length, 0 if 'in' is not COBS
+uint8_t telem_cobs_decode(const uint8_t *in, uint8_t len, uint8_t *out);
+
+#endif /* __TELEM_H_ */
@@ -0,0 +1,34 @@
+#include "clock.h"
+
+#include "toa.h"
+
+void toa_default_config(toa_config_t *config) {
+	config->sf = SPREADING_FACTOR;
+	config->bandwidth = BANDWIDTH;
+	config->coding_rate = CODING_RATE;
+	config->preamble = PREAMBLE_LENGTH;
+	config->crc = PAYLOAD_CRC;
+	config->implicit_header = 0; // lora_init() calls lora_explicit_header()
+	config->ldro = LOW_DATA_RATE_OPTIMIZE;
+}
+
+uint32_t toa_symbol_us(const toa_config_t *config) {
+	uint32_t bw = TOA_BW_HZ(config->bandwidth);
+	return (((uint64_t) 1 << config->sf) * 1000000 + bw / 2) / bw;
+}
+
+uint16_t toa_payload_symbols(const toa_config_t *config, uint8_t len) {
+	int16_t num = 8 * (int16_t) len - 4 * config->sf + 28 + 16 * config->crc - 20 * config->implicit_header;
+	int16_t den = 4 * (config->sf - 2 * config->ldro);
+	if (num <= 0) return 8;
+	return 8 + ((num + den - 1) / den) * (config->coding_rate + 4);
+}
+
+uint32_t toa_packet_us(const toa_config_t *config, uint8_t len) {
+	uint32_t bw = TOA_BW_HZ(config->bandwidth);
+	// (Npreamble + 4.25 + Npayload) symbols, counted in quarters
+	uint32_t quarters = 4 * (uint32_t) config->preamble + 17 + 4 * (uint32_t) toa_payload_symbols(config, len);
+	uint64_t us = (quarters * ((uint64_t) 1 << config->sf) * 1000000 + 2 * bw) / (4 * bw);
+	// over an hour: only long preambles at the slowest settings get there
+	return us > UINT32_MAX ? UINT32_MAX : us;
+}
\ No newline at end of file
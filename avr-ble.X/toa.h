@@ -0,0 +1,70 @@
+#ifndef __TOA_H_
+#define __TOA_H_
+
+#include "lora.h"
+
+/*
+Time on air
+
+Datasheet page 31 (4.1.1.7):
+    Tsym      = 2^SF / BW
+    Tpreamble = (Npreamble + 4.25) * Tsym
+    Npayload  = 8 + max(ceil((8PL - 4SF + 28 + 16CRC - 20IH) / (4(SF - 2DE))) * (CR + 4), 0)
+    Tpacket   = Tpreamble + Npayload * Tsym
+
+PL counts every byte written to the FIFO, so the RadioHead header is
+included. The 4.25 symbols of the preamble are kept exact by counting in
+quarter symbols.
+*/
+
+//Bandwidth code (BANDWIDTH_*) to Hz
+#define TOA_BW_HZ(bw) \
+	((bw) == BANDWIDTH_7_8_KHZ   ? 7800UL   : (bw) == BANDWIDTH_10_4_KHZ ? 10400UL  : \
+	 (bw) == BANDWIDTH_15_6_KHZ  ? 15600UL  : (bw) == BANDWIDTH_20_8_KHZ ? 20800UL  : \
+	 (bw) == BANDWIDTH_31_25_KHZ ? 31250UL  : (bw) == BANDWIDTH_41_7_KHZ ? 41700UL  : \
+	 (bw) == BANDWIDTH_62_5_KHZ  ? 62500UL  : (bw) == BANDWIDTH_125_KHZ  ? 125000UL : \
+	 (bw) == BANDWIDTH_250_KHZ   ? 250000UL : 500000UL)
+
+//Compile-time results for the CONFIG section of lora.h. Plain integer
+//expressions, so they also work in #if
+#define TOA_SYMBOL_US \
+	(((1ULL << SPREADING_FACTOR) * 1000000ULL + TOA_BW_HZ(BANDWIDTH) / 2) / TOA_BW_HZ(BANDWIDTH))
+#define TOA_PAYLOAD_NUM(len) \
+	(8L * (len) - 4L * SPREADING_FACTOR + 28 + 16L * PAYLOAD_CRC)
+#define TOA_PAYLOAD_DEN \
+	(4L * (SPREADING_FACTOR - 2 * LOW_DATA_RATE_OPTIMIZE))
+#define TOA_PAYLOAD_SYMBOLS(len) \
+	(8 + (TOA_PAYLOAD_NUM(len) > 0 ? \
+	((TOA_PAYLOAD_NUM(len) + TOA_PAYLOAD_DEN - 1) / TOA_PAYLOAD_DEN) * (CODING_RATE + 4) : 0))
+#define TOA_US(len) \
+	(((4ULL * PREAMBLE_LENGTH + 17 + 4ULL * TOA_PAYLOAD_SYMBOLS(len)) * (1ULL << SPREADING_FACTOR) * 1000000ULL \
+	+ 2 * TOA_BW_HZ(BANDWIDTH)) / (4 * TOA_BW_HZ(BANDWIDTH)))
+
+#if TOA_SYMBOL_US > 16000 && !LOW_DATA_RATE_OPTIMIZE
+#error "symbol time exceeds 16 ms, LOW_DATA_RATE_OPTIMIZE must be set"
+#endif
+
+typedef struct {
+	uint8_t sf;					// SF6 .. SF12
+	uint8_t bandwidth;			// BANDWIDTH_*
+	uint8_t coding_rate;		// CODING_RATE_*
+	uint16_t preamble;			// preamble symbols
+	uint8_t crc;				// payload CRC on
+	uint8_t implicit_header;	// implicit header mode (no explicit header symbols)
+	uint8_t ldro;				// LowDataRateOptimize
+} toa_config_t;
+
+// Fill 'config' with the settings lora_init() programs
+void toa_default_config(toa_config_t *config);
+
+// Symbol time in microseconds, rounded
+uint32_t toa_symbol_us(const toa_config_t *config);
+
+// Payload symbols for a packet of 'len' bytes, explicit header symbols included
+uint16_t toa_payload_symbols(const toa_config_t *config, uint8_t len);
+
+// Time on air of a packet of 'len' bytes in microseconds, rounded, UINT32_MAX if longer.
+// Uses 64-bit arithmetic, keep it out of tight loops and cache the result
+uint32_t toa_packet_us(const toa_config_t *config, uint8_t len);
+
+#endif /* __TOA_H_ */
@@ -0,0 +1,126 @@
+#include "clock.h"
+
+#include "trace.h"
+#include "hal.h"
+#include "tca.h"
+#include "uart.h"
+
+#include <stdio.h>
+
+typedef struct {
+    uint32_t us;
+    uint8_t event;
+} trace_entry_t;
+
+static trace_entry_t ring[TRACE_SIZE];
+static uint8_t head; // next entry to write
+static uint8_t count;
+
+/* the open sequence: when each event was seen, one bit per event in 'seen' */
+static uint32_t seq_us[TRACE_EVENTS];
+static uint8_t seq_seen;
+
+static trace_stage_t stages[TRACE_EVENTS];
+
+static const char *const names[TRACE_EVENTS] = {
+    "button", "fifo start", "fifo end", "tx start", "tx done", "rx done", "reply"
+};
+
+static void stage_add(trace_stage_t *stage, uint32_t us) {
+    if (stage->count == 0 || us < stage->min_us) stage->min_us = us;
+    if (us > stage->max_us) stage->max_us = us;
+    stage->sum_us += us;
+    stage->count++;
+}
+
+/* the reply closes the sequence: every stage that was seen in order counts */
+static void sequence_close() {
+    for (uint8_t event = TRACE_FIFO_START; event < TRACE_EVENTS; event++) {
+        stage_add(&stages[event], seq_us[event] - seq_us[event - 1]);
+    }
+    stage_add(&stages[TRACE_BUTTON], seq_us[TRACE_REPLY] - seq_us[TRACE_BUTTON]);
+    seq_seen = 0;
+}
+
+void trace_point(uint8_t event) {
+    if (event >= TRACE_EVENTS) return;
+    uint8_t sreg = hal_irq_save();
+    uint32_t now = tca_micros();
+    ring[head].us = now;
+    ring[head].event = event;
+    head = (head + 1) & (TRACE_SIZE - 1);
+    if (count < TRACE_SIZE) count++;
+
+    if (event == TRACE_BUTTON) {
+        seq_seen = 1;
+        seq_us[event] = now;
+    } else if ((seq_seen & (1 << (event - 1))) && !(seq_seen & (1 << event))) {
+        seq_seen |= 1 << event;
+        seq_us[event] = now;
+        if (event == TRACE_REPLY) sequence_close();
+    }
+    hal_irq_restore(sreg);
+}
+
+void trace_clear() {
+    uint8_t sreg = hal_irq_save();
+    head = 0;
+    count = 0;
+    seq_seen = 0;
+    for (uint8_t i = 0; i < TRACE_EVENTS; i++) {
+        stages[i] = (trace_stage_t) {0};
+    }
+    hal_irq_restore(sreg);
+}
+
+ECODE trace_stage(uint8_t event, trace_stage_t *stage) {
+    if (event >= TRACE_EVENTS) return ECODE_FAIL;
+    uint8_t sreg = hal_irq_save();
+    *stage = stages[event];
+    hal_irq_restore(sreg);
+    return ECODE_OK;
+}
+
+void trace_report() {
+    char line[80];
+    for (uint8_t event = 0; event < TRACE_EVENTS; event++) {
+        trace_stage_t stage;
+        trace_stage(event, &stage);
+        if (stage.count == 0) continue;
+        /* stage TRACE_BUTTON is the whole path */
+        const char *from = names[event == TRACE_BUTTON ? TRACE_BUTTON : event - 1];
+        const char *to = names[event == TRACE_BUTTON ? TRACE_REPLY : event];
+        sprintf(line, "%s -> %s: n %u, min %lu, max %lu, mean %lu us\r\n", from, to, stage.count,
+                (unsigned long) stage.min_us, (unsigned long) stage.max_us, (unsigned long) (stage.sum_us / stage.count));
+        uart_tx(line);
+    }
+}
+
+/* entries still to print, and the one to print next */
+static uint8_t dump_left;
+static uint8_t dump_next;
+static uint32_t dump_prev_us;
+
+void trace_dump() {
+    uint8_t sreg = hal_irq_save();
+    dump_left = count;
+    dump_next = (head - count) & (TRACE_SIZE - 1);
+    dump_prev_us = ring[dump_next].us;
+    hal_irq_restore(sreg);
+}
+
+void trace_dump_step() {
+    if (dump_left == 0) return;
+    uint8_t sreg = hal_irq_save();
+    trace_entry_t entry = ring[dump_next];
+    hal_irq_restore(sreg);
+    char line[48];
+    uint8_t len = sprintf(line, "trace %10lu us %-10s +%lu\r\n", (unsigned long) entry.us,
+                          names[entry.event], (unsigned long) (entry.us - dump_prev_us));
+    /* no room: the same line next time */
+    if (uart_tx_free() < len) return;
+    uart_tx(line);
+    dump_prev_us = entry.us;
+    dump_next = (dump_next + 1) & (TRACE_SIZE - 1);
+    dump_left--;
+}
@@ -0,0 +1,58 @@
+#ifndef __TRACE_H_
+#define __TRACE_H_
+
+#include "ecode.h"
+
+/*
+Ignite path tracing
+
+trace_point() stamps an event with tca_micros() into a RAM ring of
+TRACE_SIZE entries, overwriting the oldest. It is cheap enough for
+interrupt handlers. One ignite is one sequence: TRACE_BUTTON opens it,
+every later event counts the first time it follows the event before it,
+and TRACE_REPLY closes it. Each closed sequence adds the time of every
+stage (from the previous event to this one) to per-stage min/max/mean
+statistics; stage TRACE_BUTTON holds the whole button -> reply time.
+
+The ring is printed a line at a time with trace_dump_step(), only when
+the UART transmit buffer has room for it.
+*/
+
+// Ring entries, power of two up to 256
+#define TRACE_SIZE          32
+
+/* events on the ignite path, in order */
+#define TRACE_BUTTON        0   // IGNITE button edge
+#define TRACE_FIFO_START    1   // packet load into the radio FIFO starts
+#define TRACE_FIFO_END      2   // packet loaded
+#define TRACE_TX_START      3   // TX mode requested
+#define TRACE_TX_DONE       4   // TxDone interrupt
+#define TRACE_RX_DONE       5   // RxDone interrupt
+#define TRACE_REPLY         6   // IGNITED/REFUSED decoded
+#define TRACE_EVENTS        7
+
+typedef struct {
+    uint16_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t sum_us;
+} trace_stage_t;
+
+// Record 'event' at the current time. Safe to call from an interrupt
+void trace_point(uint8_t event);
+
+// Drop the recorded events and the statistics
+void trace_clear();
+
+// Statistics of the stage ending at 'event', ECODE_FAIL for an unknown event
+ECODE trace_stage(uint8_t event, trace_stage_t *stage);
+
+// Print min/max/mean of every stage over UART
+void trace_report();
+
+// Start printing the ring, oldest first
+void trace_dump();
+// Print the next line of a dump if the UART has room. Call periodically
+void trace_dump_step();
+
+#endif /* __TRACE_H_ */
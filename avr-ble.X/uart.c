@@ -1,39 +1,98 @@
-#define F_CPU 3333333
-// Code in the getting started guide appears to do same thing, but they do not
-// know how to code cleanly.
-// This is all based on formula in Table 23-1 of the ATmega 3208 data sheet
-// Need to shift value left 6 bits to follow format specified in data sheet:
-// 16-bit number, 10 bits are whole number part, bottom 6 are fractional part
-// The +0.5 is to force the result to be rounded *up* rather than down.
-// SAMPLES_PER_BIT: 16, for normal asynchronous mode. Given in data sheet.
-#define SAMPLES_PER_BIT 16
-#define USART_BAUD_VALUE(BAUD_RATE) (uint16_t) ((F_CPU << 6) / (((float) SAMPLES_PER_BIT) * (BAUD_RATE)) + 0.5)
+#include "clock.h"
 
 #include "uart.h"
 
+#if UART_TX_BUFFER_SIZE > 256 || (UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1)) != 0
+#error "UART_TX_BUFFER_SIZE must be a power of two up to 256"
+#endif
+#if CLOCK_USART_BAUD_VALUE(UART_BAUD_RATE) < 64 || CLOCK_USART_BAUD_VALUE(UART_BAUD_RATE) > 0xFFFF
+#error "UART_BAUD_RATE is out of the USART's range at this F_CPU"
+#endif
+#if CLOCK_USART_ERROR_PERMILLE(UART_BAUD_RATE) > CLOCK_USART_MAX_ERROR_PERMILLE
+#error "UART_BAUD_RATE is too far off at this F_CPU"
+#endif
+
+#define UART_TX_MASK (UART_TX_BUFFER_SIZE - 1)
+
+// Bytes waiting to go out, written at head by uart_tx, sent from tail by the DRE interrupt.
+// One slot is always left empty so head == tail means empty
+static uint8_t tx_buf[UART_TX_BUFFER_SIZE];
+static volatile uint8_t tx_head;
+static volatile uint8_t tx_tail;
+static uint16_t tx_dropped;
+
+void uart_dre_isr() {
+    if (tx_head != tx_tail) {
+        hal_uart_write(tx_buf[tx_tail]);
+        tx_tail = (tx_tail + 1) & UART_TX_MASK;
+    } else {
+        /* nothing left, stop the interrupt until uart_tx queues more */
+        hal_uart_tx_irq(0);
+    }
+}
+
 ECODE uart_init(uint32_t baud_rate) {
-    PORTF.DIR |= TX_PIN;
-    PORTF.DIR &= ~RX_PIN;
-    // PORTMUX.USARTROUTEA |= PORTMUX_USART2_0_bm;
-    // PORTF.PIN0CTRL |= PORT_PULLUPEN_bm;
-
-    // USART2.DBGCTRL = USART_DBGRUN_bm;
-    USART2.BAUD = USART_BAUD_VALUE(baud_rate);
-    USART2.CTRLB |= USART_TXEN_bm | USART_RXEN_bm;
-    USART2.CTRLC = USART_CMODE_ASYNCHRONOUS_gc | USART_CHSIZE_8BIT_gc | USART_RXMODE_NORMAL_gc;
+    hal_uart_init(baud_rate);
     uart_tx("uart initialised\r\n");
     return ECODE_OK;
 }
 
-void uart_putc(char c) {
-    while (!(USART2.STATUS & USART_DREIF_bm)) {}
-    USART2.TXDATAL = c;
+ECODE uart_tx(const char *send) {
+    uint8_t len = 0;
+    while (send[len] != '\0' && len < UART_TX_MASK) {
+        len++;
+    }
+    if (send[len] != '\0') {
+        uint8_t sreg = hal_irq_save();
+        tx_dropped += len;
+        hal_irq_restore(sreg);
+        return ECODE_FAIL;
+    }
+    return uart_write((const uint8_t *) send, len);
+}
+
+ECODE uart_write(const uint8_t *data, uint8_t len) {
+    ECODE status = ECODE_OK;
+    uint8_t sreg = hal_irq_save();
+    uint8_t free = (tx_tail - tx_head - 1) & UART_TX_MASK;
+    if (len > free) {
+        tx_dropped += len;
+        status = ECODE_FAIL;
+    } else {
+        uint8_t head = tx_head;
+        for (uint8_t i = 0; i < len; i++) {
+            tx_buf[head] = data[i];
+            head = (head + 1) & UART_TX_MASK;
+        }
+        tx_head = head;
+        hal_uart_tx_irq(1);
+    }
+    hal_irq_restore(sreg);
+    return status;
 }
 
-ECODE uart_tx(const char *send) {
-    for (uint8_t i = 0; send[i] != '\0'; i++) {
-        uart_putc(send[i]);
+void uart_flush() {
+    while (tx_head != tx_tail) {
+        uint8_t sreg = hal_irq_save();
+        /* feed the USART by hand in case interrupts are off (init failures) */
+        if (hal_uart_tx_ready() && tx_head != tx_tail) {
+            hal_uart_write(tx_buf[tx_tail]);
+            tx_tail = (tx_tail + 1) & UART_TX_MASK;
+        }
+        hal_irq_restore(sreg);
     }
-    return ECODE_OK;
 }
 
+uint8_t uart_tx_free() {
+    uint8_t sreg = hal_irq_save();
+    uint8_t free = (tx_tail - tx_head - 1) & UART_TX_MASK;
+    hal_irq_restore(sreg);
+    return free;
+}
+
+uint16_t uart_tx_dropped() {
+    uint8_t sreg = hal_irq_save();
+    uint16_t dropped = tx_dropped;
+    hal_irq_restore(sreg);
+    return dropped;
+}
\ No newline at end of file
@@ -16,17 +16,34 @@ Check out the CDC stuff
 #ifndef __UART_H_
 #define __UART_H_
 
-#include <avr/io.h>
-#include <util/delay.h>
-#include <avr/interrupt.h>
-#include "ecode.h"
+#include "hal.h"
 
 /* F0 - tx
  * F1 - rx */
 #define TX_PIN    PIN0_bm
 #define RX_PIN    PIN1_bm
 
+/* Console baud rate */
+#define UART_BAUD_RATE 9600
+
+/* Transmit ring buffer size in bytes, power of two up to 256 */
+#ifndef UART_TX_BUFFER_SIZE
+#define UART_TX_BUFFER_SIZE 256
+#endif
+
 ECODE uart_init(uint32_t baud_rate);
+// Queue a string for transmission and return immediately.
+// If it does not fit in the buffer the whole string is dropped, counted, and ECODE_FAIL is returned
 ECODE uart_tx(const char *send);
+// Same for 'len' bytes of binary data, zeros included
+ECODE uart_write(const uint8_t *data, uint8_t len);
+// Block until everything queued has been handed to the USART. Works with interrupts disabled
+void uart_flush();
+// Room left in the transmit buffer, a string of up to this many characters will be queued
+uint8_t uart_tx_free();
+// Bytes dropped because the transmit buffer was full
+uint16_t uart_tx_dropped();
+// Data register empty interrupt handler, called from the HAL
+void uart_dre_isr();
 
 #endif /* __UART_H_ */
\ No newline at end of file
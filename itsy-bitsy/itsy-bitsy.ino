@@ -21,6 +21,7 @@ https://learn.adafruit.com/introducting-itsy-bitsy-32u4/pinouts
 
 #include <SPI.h>
 #include <RH_RF95.h>
+#include "proto.h"
 
 /* Chip Select pin - A0, PF7 */
 #define RFM95_CS_PIN         18
@@ -32,9 +33,17 @@ https://learn.adafruit.com/introducting-itsy-bitsy-32u4/pinouts
 #define LORA_LED_PIN         11
 
 /* ADC - A2, PF5, ADC5 */
-#define ADC_PIN              20
+#define ADC_CHANNEL          5
 /* threshold ADC output to consider power on */
 #define ADC_THRESH           100
+/* Continuity is sampled free-running: the ADC converts back to back (13 ADC
+   clocks at 16 MHz / 128, 104 us) and its interrupt keeps the average of the
+   last ADC_SAMPLES readings. Continuity comes on above ADC_THRESH +
+   ADC_HYSTERESIS and goes off below ADC_THRESH - ADC_HYSTERESIS, so a clip
+   coming off shows within about 2 ms and noise at the threshold does not flicker */
+#define ADC_SAMPLES          16 // power of two
+#define ADC_HYSTERESIS       10
+#define ADC_REPORT_MS        1000
 
 /* continuity green and red channels - PD6, PC7 */
 #define GREEN_CONT_LED_PIN   12
@@ -43,12 +52,69 @@ https://learn.adafruit.com/introducting-itsy-bitsy-32u4/pinouts
 /* Relay pin - PD3 */
 #define RELAY_PIN            1
 
-/* Change to 433.0 or other frequency, must match RX's freq! */
-#define RF95_FREQ 433.0
+/* This receiver's pad number, 1 to PROTO_PAD_MAX (proto.h). Give every
+   receiver working with the same controller its own */
+#ifndef PAD_ID
+#define PAD_ID               1
+#endif
+
+/* Start on the home channel, must match the controller's! The channels are in proto.h */
+#define RF95_FREQ (proto_channel_hz(PROTO_CHANNEL_HOME) / 1e6)
+
+/* Wake-up listening, see proto.h. A CAD that finds a preamble keeps the radio
+   in receive until the packet is in or the longest wake preamble has passed */
+#define LISTEN_TIMEOUT_MS    (PROTO_WAKE_MS + 500)
+
+/* SX1276 supply current in mA (datasheet, 433 MHz band) for the estimate
+   printed every RADIO_REPORT_MS. CAD draws about what receive does. TX on
+   PA_BOOST is given at +17 and +20 dBm only, lower levels are approximate */
+#define RADIO_SLEEP_MA       0.0002
+#define RADIO_RX_MA          11.5
+#define RADIO_TX_17_MA       87.0
+#define RADIO_TX_20_MA       120.0
+#define RADIO_REPORT_MS      10000
+
+/* RSSI = register - 164 on the LF port (below 779 MHz), as RadioHead's lastRssi() */
+#define RSSI_OFFSET_LF       164
 
 /* Singleton instance of the radio driver */
 RH_RF95 lora(RFM95_CS_PIN, RFM95_INT_PIN);
 
+/* continuity input, written by the ADC interrupt */
+volatile uint16_t adcSamples[ADC_SAMPLES];
+volatile uint16_t adcSum = 0; // of adcSamples, 16 * 1023 fits
+uint8_t adcNext = 0;
+volatile uint8_t continuity = 0;
+
+/* one conversion done, the next one has already started */
+ISR(ADC_vect) {
+    uint16_t sample = ADC;
+    adcSum += sample - adcSamples[adcNext];
+    adcSamples[adcNext] = sample;
+    adcNext = (adcNext + 1) & (ADC_SAMPLES - 1);
+    uint16_t average = adcSum / ADC_SAMPLES;
+    if (average > ADC_THRESH + ADC_HYSTERESIS) {
+        continuity = 1;
+    } else if (average < ADC_THRESH - ADC_HYSTERESIS) {
+        continuity = 0;
+    }
+}
+
+/* free-running conversions of ADC_CHANNEL against AVcc, interrupt on each */
+void adcStart() {
+    DIDR0 |= _BV(ADC5D); // analog only, no digital input buffer
+    ADMUX = _BV(REFS0) | ADC_CHANNEL;
+    ADCSRB = 0; // free running, MUX5 clear
+    ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+}
+
+uint16_t adcAverage() {
+    noInterrupts();
+    uint16_t sum = adcSum;
+    interrupts();
+    return sum / ADC_SAMPLES;
+}
+
 void setup() {
     /* setup pins */
     pinMode(LORA_LED_PIN, OUTPUT);
@@ -56,7 +122,6 @@ void setup() {
     pinMode(GREEN_CONT_LED_PIN, OUTPUT);
     pinMode(RED_CONT_LED_PIN, OUTPUT);
     pinMode(RELAY_PIN, OUTPUT);
-    // no need to setup ADC_PIN, that is handled by analogRead()
 
     digitalWrite(RELAY_PIN, LOW); // THE MOST IMPORTANT PIN
     digitalWrite(RFM95_RST_PIN, HIGH);
@@ -68,6 +133,8 @@ void setup() {
 
     Serial.println("Arduino LoRa RX Test!");
 
+    adcStart();
+
     /* manual reset */
     digitalWrite(RFM95_RST_PIN, LOW);
     delay(10);
@@ -88,94 +155,384 @@ void setup() {
     }
     Serial.print("Set Freq to: "); Serial.println(RF95_FREQ);
     lora.setPayloadCRC(false);
+    /* RadioHead drops packets to other addresses, the other pads' answers among them */
+    lora.setThisAddress(PAD_ID);
 
     // The default transmitter power is 13dBm, using PA_BOOST.
     // If you are using RFM95/96/97/98 modules which uses the PA_BOOST transmitter pin, then 
     // you can set transmitter powers from 5 to 23 dBm:
-    lora.setTxPower(20, false);
+    lora.setTxPower(PROTO_POWER_MAX, false);
+    lora.setPreambleLength(proto_wake_preamble(PROTO_RATE_DEFAULT));
 
     // 433.0MHz, 20dBm, Bw = 125 kHz, Cr = 4/5, Sf = 128chips/symbol, CRC off
 }
 
+uint8_t rate = PROTO_RATE_DEFAULT;
+uint8_t power = PROTO_POWER_MAX;
+uint8_t channel = PROTO_CHANNEL_HOME;
+uint32_t lastHeard = 0; // last valid frame from the controller
+uint8_t lastSeq = 0; // its sequence number
+int8_t lastSignal = 0; // and strength
+uint8_t heardBeat = 0;
+uint32_t lastBeat = 0; // last PING or RATE, the controller's heartbeat
+uint8_t lastBeatPads = 0; // the pads it polled
+uint8_t reportedContinuity = 0; // as the controller last heard it from us
+uint32_t lastNotify = 0;
+uint8_t igniteSeq = 0; // last IGNITE acted on, a repeat within PROTO_IGNITE_BUDGET_MS + PROTO_IGNITE_LATE_MS is a retry
+uint32_t igniteAt = 0;
+uint8_t igniteAnswer = 0; // IGNITED or REFUSED, 0 before the first IGNITE
+proto_frame_t reply; // answer waiting for its slot, due at replyAt (micros)
+uint8_t replyPending = 0;
+uint32_t replyAt = 0;
+uint8_t replyRate = 0; // switch to replyNewRate once the answer is out
+uint8_t replyNewRate;
+uint8_t replyNewPower;
+uint8_t replyNewChannel;
+uint8_t rateUnconfirmed = 0; // switched at rateAt, nothing heard on the new setting since
+uint32_t rateAt = 0;
+uint8_t oldRate; // the setting before it
+uint8_t oldPower;
+uint8_t oldChannel;
+
+/* switch data rate, TX power and channel, see proto.h */
+void applyRate(uint8_t newRate, uint8_t newPower, uint8_t newChannel) {
+    rate = newRate;
+    power = newPower;
+    channel = newChannel;
+    lora.setSpreadingFactor(proto_rate_sf(rate));
+    lora.setSignalBandwidth(proto_rate_bw_hz(rate));
+    lora.setTxPower(power, false);
+    lora.setPreambleLength(proto_wake_preamble(rate));
+    lora.setFrequency(proto_channel_hz(channel) / 1e6);
+    Serial.print("Rate ");
+    Serial.print(rate, DEC);
+    Serial.print(", ");
+    Serial.print(power, DEC);
+    Serial.print(" dBm, channel ");
+    Serial.println(channel, DEC);
+}
+
+/* radio time by mode since the last report, us; the rest is sleep */
+uint32_t radioRxUs = 0;
+uint32_t radioTxUs = 0;
+uint32_t radioReportAt = 0;
+double radioChargeMas = 0; // mA s since power-up
+double radioSeconds = 0;
+double radioAverageMa = 0; // since power-up
+
+double txCurrentMa(uint8_t dbm) {
+    if (dbm >= 17) return RADIO_TX_17_MA + (RADIO_TX_20_MA - RADIO_TX_17_MA) * (dbm - 17) / 3;
+    return RADIO_TX_17_MA - 4.0 * (17 - dbm);
+}
+
+/* fold the last period into the running average and print it */
+void radioReport() {
+    double seconds = (millis() - radioReportAt) / 1000.0;
+    double rx = radioRxUs / 1e6;
+    double tx = radioTxUs / 1e6;
+    if (PROTO_WAKE_MS == 0) rx = seconds - tx; // never sleeps
+    double sleep = seconds - rx - tx;
+    if (sleep < 0) sleep = 0;
+    double charge = rx * RADIO_RX_MA + tx * txCurrentMa(power) + sleep * RADIO_SLEEP_MA;
+    radioChargeMas += charge;
+    radioSeconds += seconds;
+    radioAverageMa = radioChargeMas / radioSeconds;
+    Serial.print("Radio: ");
+    Serial.print(charge / seconds, 3);
+    Serial.print(" mA, rx ");
+    Serial.print(rx * 1000, 0);
+    Serial.print(" ms, tx ");
+    Serial.print(tx * 1000, 0);
+    Serial.println(" ms");
+    radioRxUs = 0;
+    radioTxUs = 0;
+    radioReportAt = millis();
+}
+
+/* send a frame, RadioHead emits the header from the frame's address fields */
+void sendFrame(const proto_frame_t *frame) {
+    uint8_t body[PROTO_MAX_BODY];
+    uint8_t len = proto_encode_body(frame, body);
+    lora.setHeaderTo(frame->to);
+    lora.setHeaderFrom(frame->from);
+    lora.setHeaderId(frame->seq);
+    lora.setHeaderFlags(frame->flags);
+    /* the controller listens all the time, replies need no wake-up preamble */
+    lora.setPreambleLength(PROTO_PREAMBLE_SHORT);
+    uint32_t start = micros();
+    lora.send(body, len);
+    lora.waitPacketSent();
+    radioTxUs += micros() - start;
+    lora.setPreambleLength(proto_wake_preamble(rate));
+    reportedContinuity = frame->status & PROTO_STATUS_CONTINUITY;
+}
+
+/* a notification sent now is off air before the controller's next heartbeat
+   starts and after the answers to the last one, within this pad's share of
+   the time between, reckoned from when the last heartbeat came in */
+bool notifyClear() {
+    if (!heardBeat) return false; // nobody to tell yet
+    if (!(lastBeatPads & proto_pad_bit(PAD_ID))) return false; // another pad's turn
+    int32_t beatMs = proto_frame_us(rate, proto_wake_preamble(rate)) / 1000;
+    int32_t notifyMs = proto_frame_us(rate, PROTO_PREAMBLE_SHORT) / 1000;
+    uint8_t pads = proto_pad_count(lastBeatPads);
+    int32_t first = pads * proto_slot_us(rate) / 1000;
+    int32_t last = PROTO_HEARTBEAT_MS - beatMs - PROTO_NOTIFY_GUARD_MS - notifyMs;
+    if (last <= first) return false;
+    int32_t share = (last - first) / pads;
+    int32_t start = first + proto_pad_slot(lastBeatPads, PAD_ID) * share;
+    int32_t phase = (millis() - lastBeat) % PROTO_HEARTBEAT_MS;
+    return phase >= start && phase <= start + share;
+}
+
+/* STATUS unasked, the controller shows the change without waiting for its next heartbeat */
+void notifyContinuity() {
+    proto_frame_t frame;
+    frame.to = PROTO_ADDR_CONTROLLER;
+    frame.from = PAD_ID;
+    frame.seq = lastSeq;
+    frame.flags = PROTO_FLAG_NOTIFY;
+    frame.op = PROTO_OP_STATUS;
+    frame.status = proto_status(continuity, PROTO_BATT_UNKNOWN);
+    frame.signal = lastSignal;
+    sendFrame(&frame);
+    lastNotify = millis();
+    Serial.println(continuity ? "Sent STATUS notify (continuity)\r\n" : "Sent STATUS notify (no continuity)\r\n");
+}
+
 uint8_t ledToggle = LOW;
 uint32_t ledLastOn = 0;
-uint16_t adcValue = 0;
-uint8_t continuity = 0;
+uint8_t shownContinuity = 2; // none yet, the LEDs start yellow
 uint32_t lastADC = 0;
-uint8_t printADC = 0;
+uint8_t listening = 0; // woken by a CAD, in receive until a packet or LISTEN_TIMEOUT_MS
+uint8_t polled = 0; // the last command was a fast poll, in receive until PROTO_POLL_AWAKE_MS after it
+uint32_t polledAt = 0;
+uint32_t listenStart = 0;
+uint32_t lastCad = 0;
+
+/* listen before talk, see proto.h: the RSSI in receive, a symbol in unless the radio is listening already */
+bool channelClear() {
+    if (listening) {
+        lora.setModeRx();
+    } else {
+        uint32_t start = micros();
+        lora.setModeRx();
+        delayMicroseconds(proto_rate_symbol_us(rate));
+        radioRxUs += micros() - start;
+    }
+    int16_t rssi = lora.spiRead(RH_RF95_REG_1B_RSSI_VALUE) - RSSI_OFFSET_LF;
+    return !proto_channel_busy(rate, rssi);
+}
+
+/* answer in this pad's slot, see proto.h. Due at 'at' (micros), sent from loop() */
+void queueReply(const proto_frame_t *frame, uint32_t at) {
+    reply = *frame;
+    replyAt = at;
+    replyPending = 1;
+}
+
+/* send the queued answer once its slot has come, RATE's switch follows it. A busy channel
+   holds it back for up to PROTO_LBT_ANSWER_MS, still inside the slot */
+void sendDueReply() {
+    if (!replyPending || (int32_t) (micros() - replyAt) < 0) return;
+    if (micros() - replyAt < PROTO_LBT_ANSWER_MS * 1000UL && !channelClear()) return;
+    replyPending = 0;
+    sendFrame(&reply);
+    if (replyRate) {
+        replyRate = 0;
+        oldRate = rate;
+        oldPower = power;
+        oldChannel = channel;
+        applyRate(replyNewRate, replyNewPower, replyNewChannel);
+        rateUnconfirmed = 1;
+        rateAt = millis();
+    }
+    if (!listening && PROTO_WAKE_MS > 0) lora.sleep();
+}
+
+/* end of a wake-up: count the receive time and put the radio back to sleep */
+void stopListening() {
+    if (!listening) return;
+    radioRxUs += micros() - listenStart;
+    listening = 0;
+    lora.sleep();
+}
 
 void loop() {
-    /* collect continuity info four times a second */
-    if (millis() - lastADC > 250) {
-        adcValue = analogRead(ADC_PIN);
-        printADC++;
-        if (printADC == 4) {
-            Serial.print("ADC: ");
-            Serial.println(adcValue);
-            printADC = 0;
-        }
-        if (adcValue > ADC_THRESH) {
-            digitalWrite(GREEN_CONT_LED_PIN, HIGH);
-            digitalWrite(RED_CONT_LED_PIN, LOW);
-            continuity = 1;
-        } else {
-            digitalWrite(GREEN_CONT_LED_PIN, LOW);
-            digitalWrite(RED_CONT_LED_PIN, HIGH);
-            continuity = 0;
-        }
+    /* show continuity, the ADC interrupt keeps it current */
+    if (continuity != shownContinuity) {
+        shownContinuity = continuity;
+        digitalWrite(GREEN_CONT_LED_PIN, shownContinuity ? HIGH : LOW);
+        digitalWrite(RED_CONT_LED_PIN, shownContinuity ? LOW : HIGH);
+    }
+    if (millis() - lastADC >= ADC_REPORT_MS) {
+        Serial.print("ADC: ");
+        Serial.println(adcAverage());
         lastADC = millis();
     }
+    sendDueReply();
+    /* tell the controller about a change, unless a packet is on its way in or the channel is busy */
+    if (continuity != reportedContinuity && !listening && !replyPending && millis() - lastNotify >= PROTO_NOTIFY_MS && notifyClear()) {
+        if (channelClear()) notifyContinuity();
+        if (PROTO_WAKE_MS > 0) lora.sleep();
+    }
     /* turn off lora LED */
     if (millis() - ledLastOn > 500) {
         digitalWrite(LORA_LED_PIN, LOW);
     }
+    /* the controller stayed on the old setting, some pad must have missed the RATE */
+    if (rateUnconfirmed && millis() - rateAt > PROTO_RATE_CONFIRM_MS) {
+        rateUnconfirmed = 0;
+        applyRate(oldRate, oldPower, oldChannel);
+    }
+    /* lost the controller, wait for it on the setting it falls back to */
+    if (millis() - lastHeard > PROTO_FALLBACK_MS
+            && (rate != PROTO_RATE_ROBUST || power != PROTO_POWER_MAX || channel != PROTO_CHANNEL_HOME)) {
+        applyRate(PROTO_RATE_ROBUST, PROTO_POWER_MAX, PROTO_CHANNEL_HOME);
+    }
+    if (millis() - radioReportAt >= RADIO_REPORT_MS) {
+        radioReport();
+    }
+    /* sleep between channel activity checks, listen only when one finds a preamble */
+    if (PROTO_WAKE_MS > 0 && !listening) {
+        if (millis() - lastCad < PROTO_WAKE_MS) return;
+        lastCad = millis();
+        uint32_t start = micros();
+        bool active = lora.isChannelActive();
+        radioRxUs += micros() - start;
+        if (!active) {
+            lora.sleep();
+            return;
+        }
+        listening = 1;
+        listenStart = micros();
+    }
+    if (listening && polled) {
+        if (millis() - polledAt > PROTO_POLL_AWAKE_MS) {
+            Serial.println("Fast poll over");
+            polled = 0;
+            stopListening();
+            return;
+        }
+    } else if (listening && micros() - listenStart > LISTEN_TIMEOUT_MS * 1000UL) {
+        Serial.println("Woke for nothing");
+        stopListening();
+        return;
+    }
     if (lora.available()) {
         /* Should be a message for us now */
         uint8_t buf[RH_RF95_MAX_MESSAGE_LEN];
         uint8_t len = sizeof(buf);
 
-        if (lora.recv(buf, &len)) {
-            Serial.print("Received: \"");
-            Serial.print((char*) buf);
-            Serial.print("\"\r\n");
+        bool received = lora.recv(buf, &len);
+        stopListening();
+        if (received) {
+            /* RadioHead has already stripped the header, take it from the driver */
+            proto_frame_t frame;
+            frame.to = lora.headerTo();
+            frame.from = lora.headerFrom();
+            frame.seq = lora.headerId();
+            frame.flags = lora.headerFlags();
+            if (!proto_decode_body(buf, len, &frame)) {
+                Serial.println("Received malformed frame");
+                return;
+            }
+            Serial.print("Received: op ");
+            Serial.print(frame.op, HEX);
+            Serial.print(" seq ");
+            Serial.println(frame.seq, DEC);
             Serial.print("RSSI: ");
             Serial.println(lora.lastRssi(), DEC);
-            if (len == 5 && strcmp(buf, "cork") == 0) {
-                /* turn on lora LED */
-                ledLastOn = millis();
-                digitalWrite(LORA_LED_PIN, HIGH);
-                
-                /* Send a reply */
-                if (continuity) {
-                    uint8_t message[] = {'s', 't', 'o', 'p', '\0'};
-                    lora.send(message, sizeof(message));
-                    lora.waitPacketSent();
-                    Serial.println("Sent reply \"stop\"\r\n");
-                } else {
-                    uint8_t message[] = {'s', 't', 'a', 'l', '\0'};
-                    lora.send(message, sizeof(message));
-                    lora.waitPacketSent();
-                    Serial.println("Sent reply \"stal\"\r\n");
-                }
-            } else if (len == 7 && strcmp(buf, "IGNITE") == 0) {
-                /* IGNITE */
-                if (continuity) {
-                    /* done */
-                    digitalWrite(RELAY_PIN, HIGH);
-                    delay(50); // relay pin triggers for 50ms
-                    digitalWrite(RELAY_PIN, LOW);
-                    uint8_t message[] = {'d', 'o', 'n', 'e', '\0'};
-                    lora.send(message, sizeof(message));
-                    lora.waitPacketSent();
-                    Serial.println("Sent reply \"done\"\r\n");
-                } else {
-                    /* can't */
-                    uint8_t message[] = {'c', 'a', 'n', 't', '\0'};
-                    lora.send(message, sizeof(message));
-                    lora.waitPacketSent();
-                    Serial.println("Sent reply \"cant\"\r\n");
-                }
+            uint32_t heardUs = micros();
+            lastHeard = millis();
+            rateUnconfirmed = 0;
+            lastSeq = frame.seq;
+            lastSignal = proto_signal(lora.lastRssi(), lora.lastSNR());
+            if (frame.op == PROTO_OP_PING || frame.op == PROTO_OP_RATE) {
+                heardBeat = 1;
+                lastBeat = lastHeard;
+                lastBeatPads = frame.pads;
+            }
+            polled = (frame.flags & PROTO_FLAG_POLL) != 0;
+            if (polled) polledAt = lastHeard;
+            /* commands to other pads only keep the timing */
+            bool ours = (frame.pads & proto_pad_bit(PAD_ID)) != 0;
+            uint32_t slotAt = heardUs + proto_pad_slot(frame.pads, PAD_ID) * proto_slot_us(rate);
+
+            /* replies go back to the sender and echo its sequence number */
+            proto_frame_t answer;
+            answer.to = frame.from;
+            answer.from = PAD_ID;
+            answer.seq = frame.seq;
+            answer.flags = 0;
+            answer.status = proto_status(continuity, PROTO_BATT_UNKNOWN);
+            answer.signal = proto_signal(lora.lastRssi(), lora.lastSNR());
+            switch (frame.op) {
+                case PROTO_OP_PING:
+                    if (!ours) break;
+                    /* turn on lora LED */
+                    ledLastOn = millis();
+                    digitalWrite(LORA_LED_PIN, HIGH);
+
+                    /* Send a reply */
+                    answer.op = PROTO_OP_STATUS;
+                    queueReply(&answer, slotAt);
+                    Serial.println(continuity ? "Sent STATUS (continuity)\r\n" : "Sent STATUS (no continuity)\r\n");
+                    break;
+                case PROTO_OP_RATE:
+                    if (!ours) break;
+                    /* answer on the old setting, the controller switches when every pad has */
+                    ledLastOn = millis();
+                    digitalWrite(LORA_LED_PIN, HIGH);
+                    answer.op = PROTO_OP_STATUS;
+                    queueReply(&answer, slotAt);
+                    replyRate = 1;
+                    replyNewRate = frame.rate;
+                    replyNewPower = frame.power;
+                    replyNewChannel = frame.channel;
+                    break;
+                case PROTO_OP_IGNITE:
+                    if (!ours) break;
+                    /* IGNITE, answered PROTO_RELAY_MS into the slot */
+                    slotAt += PROTO_RELAY_MS * 1000UL;
+                    if (igniteAnswer != 0 && frame.seq == igniteSeq && lastHeard - igniteAt < PROTO_IGNITE_BUDGET_MS + PROTO_IGNITE_LATE_MS) {
+                        /* the controller missed our answer, give it again without firing again */
+                        answer.op = igniteAnswer;
+                        queueReply(&answer, slotAt);
+                        Serial.println("Sent answer again for repeated IGNITE\r\n");
+                        break;
+                    }
+                    igniteSeq = frame.seq;
+                    igniteAt = lastHeard;
+                    if (continuity) {
+                        /* done */
+                        digitalWrite(RELAY_PIN, HIGH);
+                        delay(PROTO_RELAY_MS); // relay pin triggers for 50ms
+                        digitalWrite(RELAY_PIN, LOW);
+                        igniteAnswer = PROTO_OP_IGNITED;
+                        answer.op = PROTO_OP_IGNITED;
+                        queueReply(&answer, slotAt);
+                        Serial.println("Sent IGNITED\r\n");
+                    } else {
+                        /* can't */
+                        igniteAnswer = PROTO_OP_REFUSED;
+                        answer.op = PROTO_OP_REFUSED;
+                        queueReply(&answer, slotAt);
+                        Serial.println("Sent REFUSED\r\n");
+                    }
+                    break;
+                default:
+                    break;
+            }
+            if (polled) {
+                /* the operator holds ARM, stay in receive for the next command */
+                listening = 1;
+                listenStart = micros();
+            } else if (PROTO_WAKE_MS > 0) {
+                lora.sleep();
             }
+            /* the first slot is now */
+            sendDueReply();
         } else {
             Serial.println("Receive failed");
         }
@@ -0,0 +1,354 @@
+/*
+Corkstop radio frame format, shared by the controller (avr-ble.X) and the
+receiver (itsy-bitsy). The Arduino build only sees files inside the sketch
+folder, so itsy-bitsy/proto.h is a copy of avr-ble.X/proto.h - change both.
+
+Every packet on air is:
+    RadioHead header    to, from, id, flags (4 bytes)
+    body                opcode, [arguments]
+
+    PING, IGNITE        opcode, pads
+    RATE                opcode, rate, power, channel, pads
+    STATUS              opcode, status, signal
+    IGNITED, REFUSED    opcode, status
+
+The header id byte carries the sequence number. Replies echo the sequence
+number of the command they answer.
+
+Pads: one controller works up to PROTO_PAD_MAX receivers, one per pad,
+each with its own pad number 1 to PROTO_PAD_MAX as its address. The
+controller sends from PROTO_ADDR_CONTROLLER to PROTO_ADDR_BROADCAST, and
+'pads' in the body is a mask of the pads that are to act and answer, bit 0
+for pad 1. Answers go from the pad's number to the controller. The pads in
+the mask answer one after the other in slots of proto_slot_us(), lowest
+number first: the pad with k lower numbered pads in the mask starts k slots
+after the command is in, IGNITE answers PROTO_RELAY_MS later still. Every
+receiver follows the heartbeat's timing whether it is in the mask or not;
+RATE goes to every fitted pad.
+
+Notifications: when continuity changes the receiver does not wait for the
+next PING, it sends STATUS on its own with PROTO_FLAG_NOTIFY set and the
+sequence number of the last command it heard. It sends at most one per
+PROTO_NOTIFY_MS, and only when the notification is off air before the
+controller's next heartbeat would start, and once the answers to it are
+out, reckoned from when it heard the last one. Only pads in that
+heartbeat's mask notify, each in its share of the time left, in the order
+of the answer slots. The controller takes it as a
+sign of life and a continuity update, never as an answer.
+
+IGNITE is acknowledged by its answer, IGNITED or REFUSED. Without one the
+controller sends IGNITE again, same sequence number, to the pads that have
+not answered, up to
+PROTO_IGNITE_TRIES times in all and only within PROTO_IGNITE_BUDGET_MS of
+the first. The answer is due PROTO_RELAY_MS (the relay pulse) plus its time
+on air after IGNITE. The receiver fires the relay once per sequence number
+in that time and answers a repeat with the answer it gave the first time.
+A retry the controller sends just inside the budget may still be held back
+and be longer on air than the first try, so the receiver's time for a
+repeat is PROTO_IGNITE_BUDGET_MS plus PROTO_IGNITE_LATE_MS.
+
+Fast poll: while the operator holds ARM the controller pings as fast as a
+ping and its answers fit and PROTO_POLL_DUTY_PERCENT of air time allows,
+with PROTO_FLAG_POLL set. The receiver stays in receive for
+PROTO_POLL_AWAKE_MS after each such command instead of going back to its
+channel activity checks, so once it has answered one, commands need only
+the short preamble and IGNITE is on its way at once.
+
+Link adaptation: the controller picks the data rate (an index into the
+table below) and TX power for both ends and proposes a change with RATE.
+The receiver answers with STATUS on the old setting and then switches; the
+controller switches when every pad's answer has arrived. A receiver that
+hears nothing on the new setting for PROTO_RATE_CONFIRM_MS goes back to the
+old one, so a change some pad missed is undone. Both ends start at
+PROTO_RATE_DEFAULT. If a switch goes wrong anyway they lose each other, and
+both drop to PROTO_RATE_ROBUST at PROTO_POWER_MAX: the receiver after
+PROTO_FALLBACK_MS without hearing the controller, the controller after a few
+unanswered heartbeats.
+
+Channels: PROTO_CHANNEL_COUNT of them, proto_channel_hz(). Both ends start
+on PROTO_CHANNEL_HOME and fall back to it with PROTO_RATE_ROBUST. RATE
+carries the channel too, so a move to a quieter one is made, confirmed and
+undone like a rate change; the controller picks the channel (chan.h).
+Before sending, either end reads the RSSI on the channel and holds back
+while it is proto_channel_busy(): the controller for up to
+PROTO_LBT_MAX_MS, a receiver's answer for up to PROTO_LBT_ANSWER_MS into
+its slot, and a notification until its next chance. After that it sends
+anyway, the link's own packets must not wait on a neighbour forever.
+
+Wake-up: the controller pings every PROTO_HEARTBEAT_MS. Between commands
+the receiver's radio sleeps and wakes every PROTO_WAKE_MS for a channel
+activity check (CAD). Controller packets carry a preamble that covers a
+whole wake period, proto_wake_preamble(), so one check always lands on it.
+The controller listens all the time, so the receiver answers with the
+short PROTO_PREAMBLE_SHORT.
+*/
+
+#ifndef __PROTO_H_
+#define __PROTO_H_
+
+#include <stdint.h>
+
+#define PROTO_HEADER_LEN        4
+#define PROTO_MAX_BODY          5
+#define PROTO_MAX_FRAME         (PROTO_HEADER_LEN + PROTO_MAX_BODY)
+
+#define PROTO_ADDR_CONTROLLER   0x00
+#define PROTO_ADDR_BROADCAST    0xFF
+// Pad numbers are 1 to PROTO_PAD_MAX, one bit each in a pad mask
+#define PROTO_PAD_MAX           8
+#define PROTO_PADS_ALL          0xFF
+
+//Header flags, the low four bits are the application's in RadioHead
+#define PROTO_FLAG_NOTIFY       0x01 // STATUS sent unasked, see Notifications above
+#define PROTO_FLAG_POLL         0x02 // command sent in fast poll, see Fast poll above
+
+//Opcodes, controller -> receiver
+#define PROTO_OP_PING           0x01 // heartbeat, answered with PROTO_OP_STATUS
+#define PROTO_OP_IGNITE         0x02 // fire the relay, answered with IGNITED or REFUSED
+#define PROTO_OP_RATE           0x03 // change data rate, TX power and channel, answered with STATUS
+//Opcodes, receiver -> controller
+#define PROTO_OP_STATUS         0x81
+#define PROTO_OP_IGNITED        0x82
+#define PROTO_OP_REFUSED        0x83 // ignite refused, no continuity
+
+//Status byte: 7-4 reserved, 3-1 battery level, 0 continuity
+#define PROTO_STATUS_CONTINUITY     0x01
+#define PROTO_STATUS_BATT_SHIFT     1
+#define PROTO_STATUS_BATT_MASK      0x0E
+#define PROTO_BATT_UNKNOWN          0 // 1 (empty) to 7 (full) when measured
+
+//Data rates, most robust first. Every one fits a ping and its answer in
+//the 1 s heartbeat without LowDataRateOptimize
+#define PROTO_RATE_COUNT        6
+#define PROTO_RATE_ROBUST       0 // SF10, 125 kHz
+#define PROTO_RATE_DEFAULT      3 // SF7, 125 kHz
+// Symbol time at the slowest rate, PROTO_RATE_ROBUST, in us
+#define PROTO_SLOWEST_SYMBOL_US 8192UL
+#define PROTO_POWER_MIN         2 // dBm, PA_BOOST
+#define PROTO_POWER_MAX         20
+
+//Channels, PROTO_CHANNEL_STEP_HZ apart from PROTO_CHANNEL_BASE_HZ. Change them
+//to suit the band plan, both ends must agree
+#define PROTO_CHANNEL_COUNT     4
+#define PROTO_CHANNEL_BASE_HZ   433000000UL
+#define PROTO_CHANNEL_STEP_HZ   500000UL
+#define PROTO_CHANNEL_HOME      0
+// A channel is busy this far above the noise floor of the rate's bandwidth
+#define PROTO_BUSY_MARGIN_DB    10
+
+#define PROTO_HEARTBEAT_MS      1000
+// Receiver: silence before dropping to PROTO_RATE_ROBUST
+#define PROTO_FALLBACK_MS       (3 * PROTO_HEARTBEAT_MS + PROTO_HEARTBEAT_MS / 2)
+// Receiver: silence on a new setting before going back to the one before the RATE
+#define PROTO_RATE_CONFIRM_MS   (2 * PROTO_HEARTBEAT_MS + PROTO_HEARTBEAT_MS / 2)
+// Receiver channel activity check period, 0 keeps the receiver in continuous receive
+#define PROTO_WAKE_MS           (PROTO_HEARTBEAT_MS / 8)
+// Symbols a CAD takes
+#define PROTO_CAD_SYMBOLS       2
+// Preamble symbols of packets that need no wake-up, and that a receiver needs to lock on
+#define PROTO_PREAMBLE_SHORT    8
+// Symbols of a packet after its preamble, sync word, header and a PROTO_MAX_FRAME
+// payload with or without CRC, at any of the rates
+#define PROTO_FRAME_SYMBOLS     33
+// Receiver: least time between two notifications, and the distance kept from a heartbeat and its answer
+#define PROTO_NOTIFY_MS         250
+#define PROTO_NOTIFY_GUARD_MS   20
+// Fast poll: the controller's share of air time at most (the EU 433 MHz band's limit), the
+// shortest period and the gap after each answer, and how long the receiver keeps listening
+#define PROTO_POLL_DUTY_PERCENT 10
+#define PROTO_POLL_MIN_MS       100
+#define PROTO_POLL_GUARD_MS     10
+#define PROTO_POLL_AWAKE_MS     (2 * PROTO_HEARTBEAT_MS)
+// Answer slot: an answer on air and this much for the pads' timing to differ
+#define PROTO_SLOT_GUARD_MS     10
+// Listen before talk: the longest the controller holds a packet back, and a receiver its answer
+#define PROTO_LBT_MAX_MS        50
+#define PROTO_LBT_ANSWER_MS     (PROTO_SLOT_GUARD_MS / 2)
+// IGNITE: sends at most, time from the first within which the retries go, receiver relay pulse
+#define PROTO_IGNITE_TRIES      4
+#define PROTO_IGNITE_BUDGET_MS  3000
+#define PROTO_RELAY_MS          50
+// IGNITE: how much later than the first try a retry decided on within the budget can reach a pad,
+// at the slowest rate. Held back by listen before talk and the answers of every pad to a heartbeat
+// before it, then on air with the wake preamble where the first try had the short one
+#define PROTO_SLOWEST_MS(symbols) (((symbols) * PROTO_SLOWEST_SYMBOL_US + 999) / 1000)
+#define PROTO_IGNITE_LATE_MS    (PROTO_LBT_MAX_MS + PROTO_POLL_GUARD_MS \
+                                 + PROTO_PAD_MAX * (PROTO_SLOWEST_MS(PROTO_PREAMBLE_SHORT + PROTO_FRAME_SYMBOLS) + PROTO_SLOT_GUARD_MS) \
+                                 + PROTO_SLOWEST_MS((PROTO_WAKE_MS * 1000UL + PROTO_SLOWEST_SYMBOL_US - 1) / PROTO_SLOWEST_SYMBOL_US \
+                                                    + PROTO_CAD_SYMBOLS))
+
+typedef struct {
+    uint8_t to;
+    uint8_t from;
+    uint8_t seq;
+    uint8_t flags;
+    uint8_t op;
+    uint8_t status;     // STATUS, IGNITED, REFUSED
+    int8_t signal;      // STATUS: strength of the command as the receiver heard it, dBm
+    uint8_t rate;       // RATE: PROTO_RATE_* index
+    uint8_t power;      // RATE: TX power, dBm
+    uint8_t channel;    // RATE: channel, 0 to PROTO_CHANNEL_COUNT - 1
+    uint8_t pads;       // PING, IGNITE, RATE: pads to act and answer
+} proto_frame_t;
+
+// Body length for an opcode, 0 if the opcode is unknown
+static inline uint8_t proto_body_len(uint8_t op) {
+    switch (op) {
+        case PROTO_OP_PING:
+        case PROTO_OP_IGNITE:
+        case PROTO_OP_IGNITED:
+        case PROTO_OP_REFUSED:
+            return 2;
+        case PROTO_OP_STATUS:
+            return 3;
+        case PROTO_OP_RATE:
+            return 5;
+        default:
+            return 0;
+    }
+}
+
+static inline uint8_t proto_status(uint8_t continuity, uint8_t battery) {
+    return (continuity ? PROTO_STATUS_CONTINUITY : 0) | ((battery << PROTO_STATUS_BATT_SHIFT) & PROTO_STATUS_BATT_MASK);
+}
+
+static inline uint8_t proto_rate_sf(uint8_t rate) {
+    return rate < 3 ? 10 - rate : 7;
+}
+
+static inline uint32_t proto_rate_bw_hz(uint8_t rate) {
+    return rate < 4 ? 125000UL : rate == 4 ? 250000UL : 500000UL;
+}
+
+// Weakest packet the rate still receives, dBm (SX1276 datasheet, table 13).
+// Each step up the table costs 3 dB: -132 at SF10/125 kHz to -117 at SF7/500 kHz
+static inline int16_t proto_rate_sensitivity(uint8_t rate) {
+    return -132 + 3 * (int16_t) rate;
+}
+
+// Thermal noise in the rate's bandwidth with a 6 dB noise figure, dBm: -117 at 125 kHz
+static inline int16_t proto_rate_noise_floor(uint8_t rate) {
+    return rate < 4 ? -117 : rate == 4 ? -114 : -111;
+}
+
+// The channel is in use by someone, reading 'rssi' dBm while listening at 'rate'
+static inline uint8_t proto_channel_busy(uint8_t rate, int16_t rssi) {
+    return rssi >= proto_rate_noise_floor(rate) + PROTO_BUSY_MARGIN_DB;
+}
+
+static inline uint32_t proto_channel_hz(uint8_t channel) {
+    return PROTO_CHANNEL_BASE_HZ + channel * PROTO_CHANNEL_STEP_HZ;
+}
+
+static inline uint32_t proto_rate_symbol_us(uint8_t rate) {
+    return ((1UL << proto_rate_sf(rate)) * 1000000UL) / proto_rate_bw_hz(rate);
+}
+
+// Preamble symbols of a controller packet at 'rate': a whole wake period, the CAD and enough to lock on
+static inline uint16_t proto_wake_preamble(uint8_t rate) {
+    if (PROTO_WAKE_MS == 0) return PROTO_PREAMBLE_SHORT;
+    uint32_t symbol_us = proto_rate_symbol_us(rate);
+    return (PROTO_WAKE_MS * 1000UL + symbol_us - 1) / symbol_us + PROTO_CAD_SYMBOLS + PROTO_PREAMBLE_SHORT;
+}
+
+// Time on air of a frame with 'preamble' symbols at 'rate', rounded up
+static inline uint32_t proto_frame_us(uint8_t rate, uint16_t preamble) {
+    return (preamble + PROTO_FRAME_SYMBOLS) * proto_rate_symbol_us(rate);
+}
+
+// Mask bit of pad 'id', 0 if it is no pad number
+static inline uint8_t proto_pad_bit(uint8_t id) {
+    return id >= 1 && id <= PROTO_PAD_MAX ? 1 << (id - 1) : 0;
+}
+
+static inline uint8_t proto_pad_count(uint8_t pads) {
+    uint8_t count = 0;
+    for (; pads; pads &= pads - 1) count++;
+    return count;
+}
+
+// Answer slot of pad 'id' after a command to 'pads': the number of lower numbered pads in it
+static inline uint8_t proto_pad_slot(uint8_t pads, uint8_t id) {
+    return proto_pad_count(pads & (proto_pad_bit(id) - 1));
+}
+
+// Length of an answer slot at 'rate'
+static inline uint32_t proto_slot_us(uint8_t rate) {
+    return proto_frame_us(rate, PROTO_PREAMBLE_SHORT) + PROTO_SLOT_GUARD_MS * 1000UL;
+}
+
+// Strength of a packet from its RSSI and SNR: below the noise floor the RSSI reads the noise
+static inline int8_t proto_signal(int16_t rssi, int8_t snr) {
+    int16_t signal = rssi + (snr < 0 ? snr : 0);
+    return signal < -128 ? -128 : signal > 0 ? 0 : signal;
+}
+
+// Write the body of 'frame' to 'out' (PROTO_MAX_BODY bytes). Returns its length, 0 if the opcode is unknown
+static inline uint8_t proto_encode_body(const proto_frame_t *frame, uint8_t *out) {
+    uint8_t len = proto_body_len(frame->op);
+    if (len > 0) out[0] = frame->op;
+    if (frame->op == PROTO_OP_RATE) {
+        out[1] = frame->rate;
+        out[2] = frame->power;
+        out[3] = frame->channel;
+        out[4] = frame->pads;
+        return len;
+    }
+    if (frame->op == PROTO_OP_PING || frame->op == PROTO_OP_IGNITE) {
+        out[1] = frame->pads;
+        return len;
+    }
+    if (len > 1) out[1] = frame->status;
+    if (len > 2) out[2] = (uint8_t) frame->signal;
+    return len;
+}
+
+// Write header and body of 'frame' to 'out' (PROTO_MAX_FRAME bytes). Returns the packet length, 0 on error
+static inline uint8_t proto_encode(const proto_frame_t *frame, uint8_t *out) {
+    uint8_t len = proto_encode_body(frame, out + PROTO_HEADER_LEN);
+    if (len == 0) return 0;
+    out[0] = frame->to;
+    out[1] = frame->from;
+    out[2] = frame->seq;
+    out[3] = frame->flags;
+    return PROTO_HEADER_LEN + len;
+}
+
+// Parse a body into 'frame', leaving the header fields alone. Returns 1 if valid, 0 otherwise
+static inline uint8_t proto_decode_body(const uint8_t *in, uint8_t len, proto_frame_t *frame) {
+    if (len == 0 || proto_body_len(in[0]) != len) return 0;
+    frame->op = in[0];
+    frame->status = 0;
+    frame->signal = 0;
+    frame->rate = 0;
+    frame->power = 0;
+    frame->channel = 0;
+    frame->pads = 0;
+    if (frame->op == PROTO_OP_RATE) {
+        if (in[1] >= PROTO_RATE_COUNT || in[3] >= PROTO_CHANNEL_COUNT) return 0;
+        frame->rate = in[1];
+        frame->power = in[2];
+        frame->channel = in[3];
+        frame->pads = in[4];
+        return 1;
+    }
+    if (frame->op == PROTO_OP_PING || frame->op == PROTO_OP_IGNITE) {
+        frame->pads = in[1];
+        return 1;
+    }
+    if (len > 1) frame->status = in[1];
+    if (len > 2) frame->signal = (int8_t) in[2];
+    return 1;
+}
+
+// Parse a whole packet, header included, into 'frame'. Returns 1 if valid, 0 otherwise
+static inline uint8_t proto_decode(const uint8_t *in, uint8_t len, proto_frame_t *frame) {
+    if (len <= PROTO_HEADER_LEN) return 0;
+    frame->to = in[0];
+    frame->from = in[1];
+    frame->seq = in[2];
+    frame->flags = in[3];
+    return proto_decode_body(in + PROTO_HEADER_LEN, len - PROTO_HEADER_LEN, frame);
+}
+
+#endif /* __PROTO_H_ */
@@ -0,0 +1,99 @@
+#include "des.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+struct des_task {
+    const char *name;
+    void (*fn)(void *);
+    void *arg;
+    ucontext_t context;
+    uint64_t wake_ns;
+    uint8_t finished;
+};
+
+static des_task_t tasks[DES_MAX_TASKS];
+static uint8_t task_count;
+static des_task_t *current;
+static ucontext_t scheduler;
+static uint64_t now_ns;
+static uint64_t limit_ns;
+
+static void trampoline() {
+    current->fn(current->arg);
+    current->finished = 1;
+    swapcontext(&current->context, &scheduler);
+}
+
+des_task_t *des_spawn(const char *name, void (*fn)(void *), void *arg) {
+    if (task_count == DES_MAX_TASKS) {
+        fprintf(stderr, "des: too many tasks\n");
+        exit(1);
+    }
+    des_task_t *task = &tasks[task_count++];
+    task->name = name;
+    task->fn = fn;
+    task->arg = arg;
+    task->wake_ns = now_ns;
+    task->finished = 0;
+    getcontext(&task->context);
+    task->context.uc_stack.ss_sp = malloc(DES_STACK_SIZE);
+    task->context.uc_stack.ss_size = DES_STACK_SIZE;
+    task->context.uc_link = 0;
+    makecontext(&task->context, trampoline, 0);
+    return task;
+}
+
+des_task_t *des_current() {
+    return current;
+}
+
+uint64_t des_now() {
+    return now_ns;
+}
+
+// Task to run next: earliest wake-up, first spawned on a tie
+static des_task_t *next_task(const des_task_t *except) {
+    des_task_t *next = 0;
+    for (uint8_t i = 0; i < task_count; i++) {
+        des_task_t *task = &tasks[i];
+        if (task == except || task->finished) continue;
+        if (next == 0 || task->wake_ns < next->wake_ns) next = task;
+    }
+    return next;
+}
+
+void des_wait_until(uint64_t when_ns) {
+    if (when_ns < now_ns) when_ns = now_ns;
+    /* nobody else is due first: move time without a context switch */
+    des_task_t *other = next_task(current);
+    if (when_ns <= limit_ns && (other == 0 || other->wake_ns > when_ns)) {
+        now_ns = when_ns;
+        return;
+    }
+    current->wake_ns = when_ns;
+    swapcontext(&current->context, &scheduler);
+}
+
+void des_wait_ns(uint64_t ns) {
+    des_wait_until(now_ns + ns);
+}
+
+void des_wake(des_task_t *task, uint64_t when_ns) {
+    if (when_ns < now_ns) when_ns = now_ns;
+    if (task != current && when_ns < task->wake_ns) task->wake_ns = when_ns;
+}
+
+void des_run_until(uint64_t until_ns) {
+    limit_ns = until_ns;
+    while (1) {
+        des_task_t *task = next_task(0);
+        if (task == 0 || task->wake_ns > until_ns) break;
+        now_ns = task->wake_ns;
+        current = task;
+        swapcontext(&scheduler, &task->context);
+        current = 0;
+    }
+    if (until_ns > now_ns) now_ns = until_ns;
+}
@@ -0,0 +1,33 @@
+#ifndef __DES_H_
+#define __DES_H_
+
+/*
+Discrete-event core for the link simulator
+
+Each node (controller firmware, receiver sketch, operator script) runs as
+a coroutine with its own stack. A task runs until it waits for a point in
+simulated time, then the task with the earliest wake-up time runs next.
+Ties go to the task spawned first, so a run is fully deterministic.
+*/
+
+#include <stdint.h>
+
+#define DES_MAX_TASKS       24
+#define DES_STACK_SIZE      (256 * 1024)
+
+typedef struct des_task des_task_t;
+
+des_task_t *des_spawn(const char *name, void (*fn)(void *), void *arg);
+des_task_t *des_current();
+uint64_t des_now();
+
+// Suspend the running task until 'when_ns' (returns at once if that has passed)
+void des_wait_until(uint64_t when_ns);
+void des_wait_ns(uint64_t ns);
+// Bring a waiting task's wake-up forward to 'when_ns'
+void des_wake(des_task_t *task, uint64_t when_ns);
+
+// Run tasks until every one of them waits past 'until_ns', then set the time to it
+void des_run_until(uint64_t until_ns);
+
+#endif /* __DES_H_ */
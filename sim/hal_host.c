@@ -0,0 +1,323 @@
+#include "clock.h"
+
+#include "hal.h"
+#include "host.h"
+#include "lora.h"
+#include "uart.h"
+#include "tca.h"
+#include "button.h"
+#include "spi.h"
+
+#include <stdio.h>
+
+sx127x_t host_radio;
+
+static uint64_t now_ns;
+static host_stats_t stats;
+
+static uint8_t irq_enabled;
+static uint8_t uart_echo;
+static uint8_t uart_record; // between the two zeros around a telemetry record
+static FILE *uart_capture;
+static uint8_t uart_dre_enabled;
+static uint8_t radio_irq_enabled;
+static uint8_t dio0_level;
+static uint8_t dio0_pending;
+/* SPI byte by byte (hal_spi_write()): the one shifting and the one in the transmit buffer,
+   when the first is in, and the bytes in the receive buffer */
+static uint8_t spi_irq_enabled;
+static uint8_t spi_out[2];
+static uint8_t spi_out_count;
+static uint64_t spi_done_ns;
+static uint8_t spi_in[2];
+static uint8_t spi_in_count;
+static uint8_t tick_enabled;
+static uint64_t tick_ns;
+static uint64_t next_tick_ns;
+static uint32_t ticks_pending;
+static uint8_t button_irq_enabled;
+static uint8_t button_down[BUTTON_COUNT];
+static uint8_t button_pending; // bit per button
+static uint8_t idle; // in hal_idle(), a button interrupt ends it early
+static int32_t clock_ppm;
+static uint64_t (*wait_hook)(uint64_t when_ns);
+static void (*wake_hook)();
+
+// Move the clock to 'when_ns', letting the rest of a larger simulation run first.
+// A wake-up from there (host_button()) can end the wait early
+static void wait_to(uint64_t when_ns) {
+    now_ns = wait_hook ? wait_hook(when_ns) : when_ns;
+}
+
+static void service_interrupts() {
+    if (!irq_enabled) return;
+    irq_enabled = 0; // no nesting, like the AVR
+    while (ticks_pending) {
+        ticks_pending--;
+        tca_tick_isr();
+    }
+    if (dio0_pending) {
+        dio0_pending = 0;
+        lora_dio0_isr();
+    }
+    if (spi_irq_enabled && spi_in_count) {
+        spi_isr();
+    }
+    for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+        if (button_pending & (1 << i)) {
+            button_pending &= ~(1 << i);
+            button_edge_isr(i);
+        }
+    }
+    while (uart_dre_enabled) {
+        uart_dre_isr();
+    }
+    irq_enabled = 1;
+}
+
+static void update_spi() {
+    while (spi_out_count && now_ns >= spi_done_ns) {
+        uint8_t in = sx127x_transfer(&host_radio, spi_out[0], spi_done_ns);
+        stats.spi_bytes++;
+        if (spi_in_count < 2) spi_in[spi_in_count++] = in;
+        spi_out[0] = spi_out[1];
+        /* the next one was waiting, it follows without a gap */
+        if (--spi_out_count) spi_done_ns += HOST_SPI_NEXT_BYTE_NS;
+    }
+}
+
+static void update_radio() {
+    sx127x_update(&host_radio, now_ns);
+    uint8_t level = sx127x_dio0(&host_radio);
+    if (level && !dio0_level && radio_irq_enabled) {
+        dio0_pending = 1;
+    }
+    dio0_level = level;
+}
+
+void host_run_until_ns(uint64_t when_ns) {
+    while (1) {
+        uint64_t next = sx127x_next_event_ns(&host_radio);
+        if (tick_enabled && next_tick_ns < next) next = next_tick_ns;
+        if (spi_out_count && spi_done_ns < next) next = spi_done_ns;
+        if (next > when_ns) next = when_ns;
+        if (next > now_ns) wait_to(next);
+        if (tick_enabled && now_ns >= next_tick_ns) {
+            next_tick_ns += tick_ns;
+            /* one OVF flag: overflows while interrupts are off collapse into one, like on the AVR */
+            ticks_pending = 1;
+        }
+        update_spi();
+        update_radio();
+        uint8_t woken = button_pending != 0;
+        service_interrupts();
+        if (now_ns >= when_ns || (idle && woken)) break;
+    }
+}
+
+void host_advance_ns(uint64_t ns) {
+    host_run_until_ns(now_ns + ns);
+}
+
+void host_reset() {
+    now_ns = 0;
+    stats = (host_stats_t) {0};
+    irq_enabled = 0;
+    uart_dre_enabled = 0;
+    uart_record = 0;
+    radio_irq_enabled = 0;
+    dio0_level = 0;
+    dio0_pending = 0;
+    spi_irq_enabled = 0;
+    spi_out_count = 0;
+    spi_in_count = 0;
+    tick_enabled = 0;
+    ticks_pending = 0;
+    button_irq_enabled = 0;
+    button_pending = 0;
+    for (uint8_t i = 0; i < BUTTON_COUNT; i++) button_down[i] = 0;
+    sx127x_reset(&host_radio);
+    host_radio.reset_pin = 1;
+}
+
+uint64_t host_now_ns() {
+    return now_ns;
+}
+
+void host_stats(host_stats_t *out) {
+    *out = stats;
+    out->time_ns = now_ns;
+}
+
+void host_uart_echo(uint8_t on) {
+    uart_echo = on;
+}
+
+void host_uart_capture(FILE *file) {
+    uart_capture = file;
+}
+
+void host_set_wait_hook(uint64_t (*wait)(uint64_t when_ns)) {
+    wait_hook = wait;
+}
+
+void host_set_wake_hook(void (*wake)()) {
+    wake_hook = wake;
+}
+
+void host_button(uint8_t button, uint8_t down) {
+    if (button >= BUTTON_COUNT || button_down[button] == down) return;
+    button_down[button] = down;
+    if (!button_irq_enabled) return;
+    button_pending |= 1 << button;
+    if (idle && wake_hook) wake_hook();
+}
+
+void host_set_clock_ppm(int32_t ppm) {
+    clock_ppm = ppm;
+}
+
+// Nanoseconds that 'cycles' of the CPU clock take with the crystal error applied
+static uint64_t cycles_ns(uint64_t cycles) {
+    int64_t ns = cycles * 1000000000ULL / F_CPU;
+    return ns - ns * clock_ppm / (1000000 + clock_ppm);
+}
+
+void hal_clock_init() {
+}
+
+void hal_spi_init() {
+}
+
+void hal_spi_select(uint8_t selected) {
+    if (selected) stats.spi_transactions++;
+    sx127x_select(&host_radio, selected);
+    host_advance_ns(HOST_SPI_SELECT_NS / 2);
+}
+
+ECODE hal_spi_transfer(uint8_t command, const uint8_t *output, uint8_t *input, uint8_t len) {
+    for (uint16_t i = 0; i <= len; i++) {
+        /* the rest follow the first back to back, out of the transmit buffer */
+        host_advance_ns(i == 0 ? HOST_SPI_BYTE_NS : HOST_SPI_NEXT_BYTE_NS);
+        uint8_t in = sx127x_transfer(&host_radio, i == 0 ? command : (output ? output[i - 1] : 0), now_ns);
+        if (i > 0 && input) input[i - 1] = in;
+        stats.spi_bytes++;
+        update_radio();
+        service_interrupts();
+    }
+    return ECODE_OK;
+}
+
+uint8_t hal_spi_tx_ready() {
+    update_spi();
+    return spi_out_count < 2;
+}
+
+void hal_spi_write(uint8_t c) {
+    update_spi();
+    /* 2 CPU clocks to load it, as the first byte of hal_spi_transfer() */
+    if (!spi_out_count) spi_done_ns = now_ns + HOST_SPI_BYTE_NS;
+    spi_out[spi_out_count++] = c;
+}
+
+uint8_t hal_spi_rx_ready() {
+    update_spi();
+    return spi_in_count != 0;
+}
+
+uint8_t hal_spi_read() {
+    update_spi();
+    uint8_t in = spi_in[0];
+    spi_in[0] = spi_in[1];
+    if (spi_in_count) spi_in_count--;
+    return in;
+}
+
+void hal_spi_irq(uint8_t enable) {
+    spi_irq_enabled = enable;
+}
+
+void hal_radio_init() {
+    radio_irq_enabled = 1;
+}
+
+void hal_radio_reset(uint8_t level) {
+    sx127x_set_reset_pin(&host_radio, level);
+}
+
+uint8_t hal_radio_irq_take() {
+    uint8_t pending = dio0_pending;
+    dio0_pending = 0;
+    return pending;
+}
+
+void hal_button_init() {
+    button_irq_enabled = 1;
+}
+
+uint8_t hal_button_down(uint8_t button) {
+    return button < BUTTON_COUNT && button_down[button];
+}
+
+void hal_uart_init(uint32_t baud_rate) {
+}
+
+uint8_t hal_uart_tx_ready() {
+    return 1;
+}
+
+void hal_uart_write(uint8_t c) {
+    stats.uart_bytes++;
+    if (uart_capture) fputc(c, uart_capture);
+    if (c == 0) {
+        uart_record = !uart_record;
+    } else if (uart_echo && !uart_record) {
+        putchar(c);
+    }
+}
+
+void hal_uart_tx_irq(uint8_t enable) {
+    uart_dre_enabled = enable;
+}
+
+void hal_tick_init(uint16_t period) {
+    tick_ns = cycles_ns((uint64_t) period + 1);
+    next_tick_ns = now_ns + tick_ns;
+    tick_enabled = 1;
+}
+
+uint16_t hal_tick_count() {
+    if (!tick_enabled) return 0;
+    uint64_t into = tick_ns - (next_tick_ns - now_ns);
+    return into * F_CPU / 1000000000ULL;
+}
+
+uint8_t hal_tick_overflow_pending() {
+    return ticks_pending != 0;
+}
+
+void hal_delay_ms(uint16_t ms) {
+    host_advance_ns(cycles_ns((uint64_t) ms * F_CPU / 1000));
+}
+
+uint8_t hal_irq_save() {
+    uint8_t state = irq_enabled;
+    irq_enabled = 0;
+    return state;
+}
+
+void hal_irq_restore(uint8_t state) {
+    irq_enabled = state;
+    service_interrupts();
+}
+
+void hal_idle() {
+    uint64_t next = sx127x_next_event_ns(&host_radio);
+    if (tick_enabled && next_tick_ns < next) next = next_tick_ns;
+    if (spi_out_count && spi_done_ns < next) next = spi_done_ns;
+    if (next == UINT64_MAX) next = now_ns + 1000000;
+    idle = 1;
+    host_run_until_ns(next);
+    idle = 0;
+}
+
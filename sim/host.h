@@ -0,0 +1,61 @@
+#ifndef __HOST_H_
+#define __HOST_H_
+
+/*
+Host side of the HAL (hal_host.c)
+
+Simulated time only moves when the driver does something that takes time
+on the target: every SPI byte and CS window, hal_delay_ms() and
+hal_idle(), which jumps to the next timer tick, radio event or queued SPI
+byte coming in. Bytes written with hal_spi_write() shift meanwhile.
+Interrupts (tick, DIO0, SPI byte received, UART data register empty,
+button edges) are delivered at those points, unless the driver has them
+disabled with hal_irq_save(). A button edge also ends hal_idle() early, as
+the pin change interrupt wakes the AVR.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include "clock.h"
+#include "sx127x.h"
+
+// First byte of a transaction: 8 bits at the SCK clock.h picks, plus 2 CPU clocks to load it.
+// The rest wait in the transmit buffer and follow without a gap
+#define HOST_SPI_BYTE_NS        (8000000000ULL / CLOCK_SPI_HZ + 2000000000ULL / F_CPU)
+#define HOST_SPI_NEXT_BYTE_NS   (8000000000ULL / CLOCK_SPI_HZ)
+// CS toggles and call overhead around each transaction, 4 CPU clocks
+#define HOST_SPI_SELECT_NS      (4000000000ULL / F_CPU)
+
+typedef struct {
+    uint32_t spi_transactions;  // CS windows
+    uint32_t spi_bytes;
+    uint32_t uart_bytes;
+    uint64_t time_ns;
+} host_stats_t;
+
+// Radio on the controller's SPI bus
+extern sx127x_t host_radio;
+
+// Power on: time zero, radio reset, interrupts disabled
+void host_reset();
+uint64_t host_now_ns();
+// Move simulated time forward, delivering interrupts on the way
+void host_advance_ns(uint64_t ns);
+void host_run_until_ns(uint64_t when_ns);
+void host_stats(host_stats_t *stats);
+// Copy UART output to stdout (off by default), the text only: telemetry records (telem.h) are left out
+void host_uart_echo(uint8_t on);
+// Write every UART byte to 'file' as well, NULL to stop
+void host_uart_capture(FILE *file);
+// Hand waiting over to an outer simulation (link_sim): called with the time
+// to move to, returns the time reached once everything due before it has run.
+// That is earlier than asked when the wake hook has cut the wait short
+void host_set_wait_hook(uint64_t (*wait)(uint64_t when_ns));
+// Called by host_button() while the controller idles, to end its wait now
+void host_set_wake_hook(void (*wake)());
+// Set a button's level (BUTTON_ARM, BUTTON_IGNITE), every change is an edge interrupt
+void host_button(uint8_t button, uint8_t down);
+// Crystal error of the controller, stretches the tick and busy waits
+void host_set_clock_ppm(int32_t ppm);
+
+#endif /* __HOST_H_ */
@@ -0,0 +1,235 @@
+#include "link.h"
+#include "host.h"
+#include "receiver.h"
+
+#include <math.h>
+
+#define MS      1000000ULL
+
+const receiver_t *const receivers[RECEIVER_COUNT] = {
+    &receiver_1, &receiver_2, &receiver_3, &receiver_4,
+    &receiver_5, &receiver_6, &receiver_7, &receiver_8,
+};
+
+static link_config_t config;
+static link_stats_t stats;
+static uint32_t state;
+/* receivers' packets on air, for collisions and channel activity checks */
+static uint64_t up_start_ns, up_preamble_ns, up_end_ns;
+static link_modem_t up_modem;
+
+uint32_t link_random() {
+    /* xorshift32 */
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static void controller_modem(link_modem_t *modem) {
+    modem->sf = sx127x_sf(&host_radio);
+    modem->bw_hz = sx127x_bw_hz(&host_radio);
+    modem->power = sx127x_tx_power(&host_radio);
+    /* the synthesizer runs off the crystal */
+    double ppm = config.xtal_ppm + config.xtal_ppm_per_min * host_now_ns() / 60e9;
+    modem->freq_hz = sx127x_freq_hz(&host_radio) * (1 + ppm / 1e6);
+}
+
+uint32_t link_controller_freq_hz() {
+    link_modem_t modem;
+    controller_modem(&modem);
+    return modem.freq_hz;
+}
+
+static int16_t draw_rssi(const link_modem_t *modem) {
+    int16_t rssi = config.rssi - (20 - modem->power);
+    if (config.rssi_jitter == 0) return rssi;
+    return rssi - config.rssi_jitter + (int16_t) (link_random() % (2 * config.rssi_jitter + 1));
+}
+
+static double noise_floor(const link_modem_t *modem) {
+    return -174 + 10 * log10(modem->bw_hz) + 6;
+}
+
+static int8_t snr(int16_t rssi, const link_modem_t *modem) {
+    double db = rssi - noise_floor(modem);
+    return db > LINK_SNR_MAX ? LINK_SNR_MAX : (int8_t) floor(db);
+}
+
+/* below the demodulation floor: -7.5 dB at SF7, 2.5 dB lower per SF */
+static uint8_t below_floor(int8_t snr, const link_modem_t *modem) {
+    return snr * 2 < -5 * (modem->sf - 4);
+}
+
+/* lost at random, or below the demodulation floor */
+static uint8_t draw_lost(int8_t snr, const link_modem_t *modem) {
+    if (below_floor(snr, modem)) return 1;
+    return link_random() < config.loss * 4294967296.0;
+}
+
+static uint32_t freq_offset(const link_modem_t *modem, uint32_t freq_hz) {
+    return modem->freq_hz > freq_hz ? modem->freq_hz - freq_hz : freq_hz - modem->freq_hz;
+}
+
+static uint8_t same_setting(const link_modem_t *a, const link_modem_t *b) {
+    return a->sf == b->sf && a->bw_hz == b->bw_hz && freq_offset(a, b->freq_hz) < a->bw_hz / 4;
+}
+
+/* 'freq_hz' falls in the receive bandwidth */
+static uint8_t in_band(const link_modem_t *modem, uint32_t freq_hz) {
+    return freq_offset(modem, freq_hz) < modem->bw_hz / 2;
+}
+
+/* an interferer's burst is on air somewhere in 'start_ns'..'end_ns', in the band of 'modem' */
+static uint8_t burst(const link_modem_t *modem, uint64_t start_ns, uint64_t end_ns) {
+    const link_interferer_t *interferer = &config.interferer;
+    if (!interferer->freq_hz || !in_band(modem, interferer->freq_hz)) return 0;
+    uint64_t from = interferer->from_ms * MS;
+    uint64_t period = interferer->period_ms * MS;
+    if (end_ns <= from) return 0;
+    uint64_t t = start_ns > from ? start_ns : from;
+    uint64_t phase = (t - from) % period;
+    return phase < interferer->on_ms * MS || t + (period - phase) < end_ns;
+}
+
+/* a packet at 'rssi' under a burst: its SNR against the burst, if that is worse */
+static int8_t jammed_snr(int16_t rssi, int8_t ratio) {
+    int16_t db = rssi - config.interferer.rssi;
+    return db < ratio ? db : ratio;
+}
+
+static uint64_t symbol_ns(const link_modem_t *modem) {
+    return (1000000000ULL << modem->sf) / modem->bw_hz;
+}
+
+/* the receiver has to be listening by this point to catch the packet */
+static uint64_t lock_ns(const link_modem_t *modem, uint16_t preamble, uint64_t start_ns) {
+    if (preamble < LINK_LOCK_SYMBOLS) return start_ns;
+    return start_ns + (preamble - LINK_LOCK_SYMBOLS) * symbol_ns(modem);
+}
+
+/* a controller packet to every receiver in the field, returns how many took it */
+static uint8_t to_receivers(const uint8_t *buf, uint8_t len, uint16_t preamble, uint64_t start_ns, uint64_t end_ns) {
+    link_modem_t from, to;
+    controller_modem(&from);
+    uint8_t delivered = 0;
+    for (uint8_t i = 0; i < RECEIVER_COUNT; i++) {
+        if (!(config.pads & (1 << i))) continue;
+        const receiver_t *receiver = receivers[i];
+        receiver->modem(&to);
+        stats.down.sent++;
+        int16_t rssi = draw_rssi(&from);
+        int8_t ratio = snr(rssi, &from);
+        uint64_t lock = lock_ns(&from, preamble, start_ns);
+        uint8_t hit = burst(&from, lock, end_ns);
+        int8_t heard = hit ? jammed_snr(rssi, ratio) : ratio;
+        if (draw_lost(ratio, &from)) {
+            stats.down.lost++;
+        } else if (!same_setting(&from, &to)) {
+            stats.down.mismatched++;
+        } else if (hit && below_floor(heard, &from)) {
+            stats.down.jammed++;
+        } else if (!receiver->deliver(buf, len, rssi, heard, lock)) {
+            stats.down.missed++;
+        } else {
+            delivered++;
+        }
+    }
+    return delivered;
+}
+
+static void controller_sent(sx127x_t *radio, const uint8_t *buf, uint8_t len, uint64_t start_ns, uint64_t end_ns) {
+    if (config.on_controller_tx) config.on_controller_tx(buf, len, start_ns);
+    to_receivers(buf, len, sx127x_preamble(radio), start_ns, end_ns);
+}
+
+uint8_t link_controller_repeat(const uint8_t *buf, uint8_t len, uint16_t preamble, uint64_t start_ns, uint64_t end_ns) {
+    return to_receivers(buf, len, preamble, start_ns, end_ns);
+}
+
+void link_from_receiver(const uint8_t *buf, uint8_t len, const link_modem_t *modem, uint16_t preamble,
+                        uint64_t start_ns, uint64_t end_ns) {
+    link_modem_t to;
+    controller_modem(&to);
+    stats.up.sent++;
+    int16_t rssi = draw_rssi(modem);
+    int8_t ratio = snr(rssi, modem);
+    uint8_t hit = burst(modem, start_ns, end_ns);
+    int8_t heard = hit ? jammed_snr(rssi, ratio) : ratio;
+    uint8_t overlap = start_ns < up_end_ns;
+    if (!overlap || end_ns > up_end_ns) {
+        up_start_ns = start_ns;
+        up_preamble_ns = start_ns + preamble * symbol_ns(modem);
+        up_end_ns = end_ns;
+        up_modem = *modem;
+    }
+    if (overlap) {
+        /* this one and whatever of the other was still coming in */
+        stats.up.collided += 1 + sx127x_collide(&host_radio, start_ns);
+    } else if (draw_lost(ratio, modem)) {
+        stats.up.lost++;
+    } else if (!same_setting(modem, &to)) {
+        stats.up.mismatched++;
+    } else if (hit && below_floor(heard, modem)) {
+        stats.up.jammed++;
+    } else if (host_radio.tx_active) {
+        /* the controller talking over the start of it; the radio model counts a packet that ends outside receive */
+        stats.up.missed++;
+    } else {
+        int32_t offset = (int32_t) modem->freq_hz - (int32_t) to.freq_hz;
+        sx127x_receive(&host_radio, buf, len, preamble, rssi, heard, offset, 0, start_ns);
+    }
+}
+
+uint8_t link_channel_active(const link_modem_t *modem, uint64_t from_ns, uint64_t to_ns) {
+    link_modem_t from;
+    if (from_ns >= up_start_ns && to_ns <= up_preamble_ns && same_setting(&up_modem, modem)) {
+        int16_t rssi = draw_rssi(&up_modem);
+        return !(snr(rssi, &up_modem) * 2 < -5 * (up_modem.sf - 4));
+    }
+    controller_modem(&from);
+    if (!host_radio.tx_active || !same_setting(&from, modem)) return 0;
+    uint64_t preamble_end = host_radio.tx_start_ns + sx127x_preamble(&host_radio) * symbol_ns(&from);
+    if (from_ns < host_radio.tx_start_ns || to_ns > preamble_end) return 0;
+    /* CAD works down to about the demodulation floor */
+    int16_t rssi = draw_rssi(&from);
+    return !(snr(rssi, &from) * 2 < -5 * (from.sf - 4));
+}
+
+int16_t link_channel_rssi(const link_modem_t *modem, uint64_t now_ns) {
+    int16_t rssi = (int16_t) floor(noise_floor(modem));
+    if (burst(modem, now_ns, now_ns + 1) && config.interferer.rssi > rssi) rssi = config.interferer.rssi;
+    link_modem_t from;
+    controller_modem(&from);
+    if (host_radio.tx_active && now_ns >= host_radio.tx_start_ns && now_ns < host_radio.tx_end_ns
+            && in_band(modem, from.freq_hz)) {
+        int16_t packet = config.rssi - (20 - from.power);
+        if (packet > rssi) rssi = packet;
+    }
+    if (now_ns >= up_start_ns && now_ns < up_end_ns && in_band(modem, up_modem.freq_hz)) {
+        int16_t packet = config.rssi - (20 - up_modem.power);
+        if (packet > rssi) rssi = packet;
+    }
+    return rssi;
+}
+
+static int16_t controller_rssi(sx127x_t *radio, uint64_t now_ns) {
+    link_modem_t modem;
+    controller_modem(&modem);
+    return link_channel_rssi(&modem, now_ns);
+}
+
+void link_init(const link_config_t *link_config) {
+    config = *link_config;
+    stats = (link_stats_t) {{0}};
+    state = config.seed ? config.seed : 1;
+    if (config.pads == 0) config.pads = 1;
+    up_start_ns = up_preamble_ns = up_end_ns = 0;
+    host_radio.on_tx = controller_sent;
+    host_radio.channel_rssi = controller_rssi;
+}
+
+void link_stats(link_stats_t *out) {
+    *out = stats;
+    out->up.missed += host_radio.rx_missed;
+}
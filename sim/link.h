@@ -0,0 +1,100 @@
+#ifndef __LINK_H_
+#define __LINK_H_
+
+/*
+Radio channel between the simulated controller (host_radio) and the
+receiver sketch
+
+The path is fixed by the RSSI a packet sent at 20 dBm arrives with; lower
+TX power arrives that much weaker. The SNR follows from the thermal noise
+in the receive bandwidth (6 dB noise figure), and a packet below the
+demodulation floor of its spreading factor is lost. On top of that every
+packet is lost with a fixed probability, drawn for each receiver a
+command reaches. Two receivers' packets that overlap on air are both lost
+at the controller, there is no capture. Both ends must be on the same
+spreading factor, bandwidth and frequency (within a quarter of the
+bandwidth), and a node that is transmitting hears nothing. The
+controller's radio crystal may be off and drifting, and its carrier
+with it, sending and receiving. A receiver has to be listening by the last LINK_LOCK_SYMBOLS
+of the preamble to pick a packet up, and a channel activity check finds
+a packet while its preamble is on air, the controller's or another
+receiver's. Random numbers come from one seeded generator, so a run repeats
+exactly.
+
+An interferer, another system on one frequency, sends bursts on a fixed
+cycle and is heard as strongly everywhere. A packet on that frequency
+that overlaps a burst from the time the receiver locks on is lost if the
+burst leaves it below the demodulation floor, and its SNR is taken
+against the burst otherwise. The
+RSSI a listening radio reads (link_channel_rssi()) is the strongest of the
+noise floor, a burst and a packet on air on its frequency.
+*/
+
+#include <stdint.h>
+
+// The SX127x reports no better SNR than this
+#define LINK_SNR_MAX            10
+// Preamble symbols the receiver needs to hear to lock on to a packet
+#define LINK_LOCK_SYMBOLS       6
+
+typedef struct {
+    uint32_t freq_hz;       // 0 for none
+    int16_t rssi;           // dBm
+    uint16_t on_ms;         // each burst
+    uint16_t period_ms;     // from one burst to the next
+    uint32_t from_ms;       // the first burst
+} link_interferer_t;
+
+typedef struct {
+    uint32_t seed;
+    double loss;            // probability a packet is lost, each direction
+    int16_t rssi;           // dBm at 20 dBm TX power
+    uint8_t rssi_jitter;    // +/- dB
+    // Optional: the controller started sending a packet at 'start_ns' (called once it is sent)
+    void (*on_controller_tx)(const uint8_t *buf, uint8_t len, uint64_t start_ns);
+    uint8_t pads;           // receivers in the field, a mask of pad numbers as in proto.h; 0 is pad 1 alone
+    link_interferer_t interferer;
+    // Controller's radio crystal: error at power-up and how fast it drifts, the receivers' are exact
+    double xtal_ppm;
+    double xtal_ppm_per_min;
+} link_config_t;
+
+typedef struct {
+    uint8_t sf;
+    uint32_t bw_hz;
+    int8_t power;           // dBm
+    uint32_t freq_hz;
+} link_modem_t;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t lost;          // by the channel: random loss or below the demodulation floor
+    uint32_t mismatched;    // the far end was on another data rate or channel
+    uint32_t jammed;        // below the demodulation floor under an interferer's burst
+    uint32_t missed;        // the far end was not listening
+    uint32_t collided;      // overlapped another receiver's packet
+} link_dir_stats_t;
+
+typedef struct {
+    link_dir_stats_t down;  // controller -> receiver, a packet for each receiver in the field
+    link_dir_stats_t up;    // receiver -> controller
+} link_stats_t;
+
+// Hooks the channel to host_radio, call after host_reset()
+void link_init(const link_config_t *config);
+// Receiver started sending a packet with 'preamble' symbols, on air from 'start_ns' to 'end_ns'
+void link_from_receiver(const uint8_t *buf, uint8_t len, const link_modem_t *modem, uint16_t preamble,
+                        uint64_t start_ns, uint64_t end_ns);
+// Channel activity check by a receiver over 'from_ns'..'to_ns': 1 if a preamble was on air throughout
+uint8_t link_channel_active(const link_modem_t *modem, uint64_t from_ns, uint64_t to_ns);
+// The controller's packet 'buf' again, as if it had been on air with 'preamble' symbols from 'start_ns'
+// to 'end_ns' (now). Returns the receivers that took it
+uint8_t link_controller_repeat(const uint8_t *buf, uint8_t len, uint16_t preamble, uint64_t start_ns, uint64_t end_ns);
+// RSSI a radio listening with 'modem' reads at 'now_ns', dBm
+int16_t link_channel_rssi(const link_modem_t *modem, uint64_t now_ns);
+// Carrier the controller's radio is on, its crystal error included
+uint32_t link_controller_freq_hz();
+uint32_t link_random();
+void link_stats(link_stats_t *stats);
+
+#endif /* __LINK_H_ */
@@ -0,0 +1,577 @@
+/*
+End-to-end link simulator
+
+Runs the controller firmware (avr-ble.X/main.c on the host HAL and the
+SX127x model) against the receiver sketch (itsy-bitsy/itsy-bitsy.ino on
+the RadioHead stand-in) over a lossy channel, with an operator pressing
+ARM and IGNITE. Reports how long firing takes, how old the controller's
+last STATUS is when it fires, and how often it shows "no connection"
+while the receiver is up the whole time. The buttons bounce on every
+press and release. -c takes the igniter clip off and puts it back every
+so often and reports how long the receiver and then the controller's
+continuity LED take to show it. -b checks that the arm hold time and the IGNITE press
+to TX start latency stay within BOUND_ARM_MS and BOUND_IGNITE_MS, or for
+a press that found a heartbeat, its answers or a busy channel ahead of it
+within the controller's igniteWaitBound() more, and exits with status 1 if not.
+
+-p fits pads 1 to n, each a receiver of its own on the same channel (the
+clip is pad 1's). Every trial fires all of them unless -s picks one with
+long IGNITE presses before the first trial, after a tap that must not; the spread from the first relay to
+the last is reported, and how long each pad's STATUS takes to come round
+against the bound the controller works out.
+
+-i puts an interferer on a channel (proto.h), from the start or from a
+given second on: INTERFERER_ON_MS bursts every INTERFERER_PERIOD_MS at -I
+dBm. The controller is expected to move the link off it; the channel it
+ends on, the occupancy it measured and how often listen before talk held
+a packet back are reported.
+
+-x puts the controller's radio crystal off by some ppm, drifting by
+another amount every minute; its frequency correction has to follow.
+
+-R sends each trial's IGNITE to the pads again, unchanged, the given ms
+after the first went on air: a retry the controller decided on within
+PROTO_IGNITE_BUDGET_MS and that was then held back. The pads must answer
+it without firing again; with -b the run fails if one does.
+
+-v shows the controller's console text, -t writes everything it sends
+to a file, telemetry records included, for telem_csv.
+
+    ./link_sim [-n trials] [-l loss] [-r rssi] [-j jitter] [-p pads] [-s pad]
+               [-d controller ppm] [-D receiver ppm] [-o] [-c clip ms]
+               [-i channel[,from s]] [-I dBm] [-x ppm[,ppm per min]] [-R ms] [-S seed] [-b]
+               [-v] [-t file]
+*/
+
+#include "des.h"
+#include "host.h"
+#include "link.h"
+#include "receiver.h"
+#include "proto.h"
+#include "toa.h"
+#include "adr.h"
+#include "button.h"
+#include "pad.h"
+#include "chan.h"
+#include "afc.h"
+#include "lora.h"
+#include "uart.h"
+
+#include <avr/io.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MS                      1000000ULL
+
+/* controller pins, as in main.c */
+#define GREEN_CONT_LED_PIN      PIN5_bm     // PD5
+#define RED_CONT_LED_PIN        PIN7_bm     // PD7
+#define GREEN_IGN_LED_PIN       PIN0_bm     // PA0
+#define RED_IGN_LED_PIN         PIN3_bm     // PF3
+
+// First trial starts once the heartbeat has had time to connect
+#define WARMUP_MS               3000
+// Operator: pause before each trial (plus up to as much again at random), reaction to the armed LED
+#define IDLE_MS                 1000
+#define REACTION_MS             100
+// Give up waiting for the armed LED / the IGNITED reply
+#define ARM_TIMEOUT_MS          1500
+#define FIRE_TIMEOUT_MS         5000
+// Contact bounce: this many extra edges, this far apart, after each press and release
+#define BOUNCES                 4
+#define BOUNCE_NS               300000
+// ARM hold in main.c, and the bounds -b checks: armed LED up to this late, IGNITE on air this soon
+#define ARM_HOLD_MS             1000
+#define BOUND_ARM_MS            2
+#define BOUND_IGNITE_MS         2
+// IGNITE held without ARM this long steps the pad selection in main.c
+#define SELECT_HOLD_MS          1000
+// Clip changes: how often the receiver's continuity and the controller's LED are looked at, and when to give up
+#define CLIP_POLL_NS            10000
+#define CLIP_TIMEOUT_MS         3000
+// Interferer: bursts this long, this often, this strong by default
+#define INTERFERER_ON_MS        30
+#define INTERFERER_PERIOD_MS    100
+#define INTERFERER_RSSI         -80
+
+PORT_t PORTA, PORTC, PORTD, PORTF;
+
+/* the controller application */
+int controller_main();
+extern uint8_t hasConnection;
+extern uint8_t receivedGood;
+extern uint8_t igniteUnanswered;
+extern uint16_t igniteRetries;
+extern uint8_t padsFitted;
+extern uint8_t selectedPads;
+uint8_t answerExpected();
+uint8_t beatSlots();
+uint32_t statusBound();
+uint32_t igniteWaitBound();
+
+typedef struct {
+    double *values; // ms
+    uint32_t count;
+    uint32_t size;
+} series_t;
+
+static series_t armReady, igniteAir, igniteWait, igniteRelay, igniteDone, armDone, statusAge, relaySpread, statusGap;
+static uint32_t trials = 100;
+static uint32_t done, refused, noReply, notArmed, firedTwice;
+static uint32_t igniteOver; // presses on air later than their bound
+static uint8_t finished;
+
+static uint64_t relayAt, relayLastAt;
+static uint8_t relayFires[RECEIVER_COUNT]; // this trial
+static uint8_t relayPads; // pads whose relay fired this trial
+static uint8_t pads = 1; // -p
+static uint8_t selectPad; // -s, 0 fires them all
+static uint32_t notAll; // IGNITED, but not every pad's relay fired
+static uint8_t selectWrong; // -s did not end on the pad asked for
+static uint64_t igniteAt, igniteAirAt;
+static uint8_t igniteBuf[PROTO_MAX_FRAME]; // the first IGNITE of the trial, for -R
+static uint8_t igniteLen;
+static uint32_t repeatMs; // -R, 0 for none
+static uint32_t repeatsHeard; // pads that took the late repeat
+static uint8_t airBusy; // a packet was on air, or the answer to one due, when IGNITE was pressed
+static uint16_t heldAt; // chan_held() when IGNITE was pressed
+static uint32_t waitBoundMs; // igniteWaitBound() then
+static des_task_t *controller;
+static uint8_t held[BUTTON_COUNT];
+static uint64_t lastStatusAt;
+static uint64_t downSince, downNs, monitorFrom;
+static uint32_t drops;
+static uint32_t clipMs; // -c, 0 leaves the clip on
+static uint16_t clipAdc; // reading with the clip on
+static series_t clipOff, clipOn, clipOffLed, clipOnLed;
+
+static void series_add(series_t *series, uint64_t ns) {
+    if (series->count == series->size) {
+        series->size = series->size ? series->size * 2 : 64;
+        series->values = realloc(series->values, series->size * sizeof(double));
+    }
+    series->values[series->count++] = ns / 1e6;
+}
+
+static int compare(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const series_t *series, uint8_t p) {
+    return series->values[(series->count - 1) * p / 100];
+}
+
+static void series_print(const char *name, series_t *series) {
+    if (series->count == 0) {
+        printf("%-24s %6u\n", name, 0);
+        return;
+    }
+    qsort(series->values, series->count, sizeof(double), compare);
+    double sum = 0;
+    for (uint32_t i = 0; i < series->count; i++) sum += series->values[i];
+    printf("%-24s %6u %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f\n", name, series->count,
+           series->values[0], percentile(series, 50), percentile(series, 90),
+           percentile(series, 99), series->values[series->count - 1], sum / series->count);
+}
+
+static uint8_t ignite_led(uint8_t green, uint8_t red) {
+    return !!(PORTA.OUT & GREEN_IGN_LED_PIN) == green && !!(PORTF.OUT & RED_IGN_LED_PIN) == red;
+}
+
+static void on_relay(uint8_t pad, uint8_t on) {
+    if (!on) return;
+    if (relayAt == 0) relayAt = des_now();
+    relayLastAt = des_now();
+    relayPads |= proto_pad_bit(pad);
+    relayFires[pad - 1]++;
+}
+
+static void controller_task(void *arg) {
+    controller_main();
+}
+
+static uint64_t controller_wait(uint64_t when_ns) {
+    des_wait_until(when_ns);
+    return des_now();
+}
+
+static void controller_wake() {
+    des_wake(controller, des_now());
+}
+
+/* first IGNITE on air after the button */
+static void controller_tx(const uint8_t *buf, uint8_t len, uint64_t start_ns) {
+    if (len > PROTO_HEADER_LEN && buf[PROTO_HEADER_LEN] == PROTO_OP_IGNITE && igniteAirAt == 0) {
+        igniteAirAt = start_ns;
+        memcpy(igniteBuf, buf, len);
+        igniteLen = len;
+    }
+}
+
+/* watch what the controller shows, every millisecond */
+static void monitor_task(void *arg) {
+    uint8_t lastGood = 0;
+    uint8_t connected = 0;
+    uint32_t heardAt[PROTO_PAD_MAX] = {0};
+    uint64_t statusAt[PROTO_PAD_MAX] = {0};
+    while (1) {
+        uint64_t now = des_now();
+        /* time between two STATUS from the same pad, once the trials run */
+        for (uint8_t id = 1; id <= pads; id++) {
+            const pad_t *pad = pad_get(id);
+            if (!pad->heard || pad->heard_at == heardAt[id - 1]) continue;
+            heardAt[id - 1] = pad->heard_at;
+            if (statusAt[id - 1] && now >= WARMUP_MS * MS) series_add(&statusGap, now - statusAt[id - 1]);
+            statusAt[id - 1] = now;
+        }
+        if (receivedGood && !lastGood) lastStatusAt = now;
+        lastGood = receivedGood;
+        if (hasConnection && !connected) {
+            if (monitorFrom == 0) monitorFrom = now;
+            else downNs += now - downSince;
+        } else if (!hasConnection && connected) {
+            downSince = now;
+            drops++;
+        }
+        connected = hasConnection;
+        des_wait_ns(MS);
+    }
+}
+
+static uint8_t continuity_led(uint8_t green, uint8_t red) {
+    return !!(PORTD.OUT & GREEN_CONT_LED_PIN) == green && !!(PORTD.OUT & RED_CONT_LED_PIN) == red;
+}
+
+/* set the continuity input and time how long the receiver, and then the
+   controller's continuity LED, take to follow */
+static void clip(uint16_t adc, uint8_t continuity, series_t *receiver, series_t *led) {
+    uint64_t at = des_now();
+    receivers[0]->set_adc(adc);
+    while (receivers[0]->continuity() != continuity && des_now() - at < CLIP_TIMEOUT_MS * MS) {
+        des_wait_ns(CLIP_POLL_NS);
+    }
+    if (receivers[0]->continuity() != continuity) return;
+    series_add(receiver, des_now() - at);
+    while (!continuity_led(continuity, !continuity) && des_now() - at < CLIP_TIMEOUT_MS * MS) {
+        des_wait_ns(CLIP_POLL_NS);
+    }
+    if (continuity_led(continuity, !continuity)) series_add(led, des_now() - at);
+}
+
+/* the igniter clip comes off for clipMs, then stays on for clipMs to twice that */
+static void clip_task(void *arg) {
+    des_wait_ns(WARMUP_MS * MS);
+    while (1) {
+        des_wait_ns((clipMs + link_random() % clipMs) * MS);
+        clip(0, 0, &clipOff, &clipOffLed);
+        des_wait_ns(clipMs * MS);
+        clip(clipAdc, 1, &clipOn, &clipOnLed);
+    }
+}
+
+/* change a button's level, bouncing for BOUNCES edges first */
+static void press(uint8_t button, uint8_t down) {
+    if (held[button] == down) return;
+    held[button] = down;
+    for (uint8_t i = 0; i < BOUNCES; i++) {
+        host_button(button, (i & 1) ? !down : down);
+        des_wait_ns(BOUNCE_NS);
+    }
+    host_button(button, down);
+}
+
+/* one ARM - IGNITE sequence per trial, as an operator would */
+static void operator_task(void *arg) {
+    des_wait_ns(WARMUP_MS * MS);
+    /* IGNITE held without ARM steps the selection: all, pad 1, pad 2 ... A tap does not */
+    for (uint8_t step = 0; selectPad && step <= selectPad; step++) {
+        press(BUTTON_IGNITE, 1);
+        des_wait_ns((step ? SELECT_HOLD_MS + REACTION_MS : REACTION_MS) * MS);
+        press(BUTTON_IGNITE, 0);
+        des_wait_ns(REACTION_MS * MS);
+    }
+    uint8_t selected = selectPad ? proto_pad_bit(selectPad) : padsFitted;
+    selectWrong = selectedPads != selected;
+    for (uint32_t trial = 0; trial < trials; trial++) {
+        des_wait_ns((IDLE_MS + link_random() % IDLE_MS) * MS);
+        uint64_t armAt = des_now();
+        press(BUTTON_ARM, 1);
+        /* ARM clears whatever the IGNITE LED showed last time, then it goes yellow
+           after a second with a connection */
+        while (!ignite_led(0, 0) && des_now() - armAt < ARM_TIMEOUT_MS * MS) {
+            des_wait_ns(MS);
+        }
+        while (!ignite_led(1, 1) && des_now() - armAt < ARM_TIMEOUT_MS * MS) {
+            des_wait_ns(MS);
+        }
+        if (!ignite_led(1, 1)) {
+            notArmed++;
+            press(BUTTON_ARM, 0);
+            continue;
+        }
+        series_add(&armReady, des_now() - armAt);
+
+        des_wait_ns(REACTION_MS * MS);
+        igniteAt = des_now();
+        series_add(&statusAge, igniteAt - lastStatusAt);
+        relayAt = 0;
+        relayPads = 0;
+        memset(relayFires, 0, sizeof(relayFires));
+        igniteAirAt = 0;
+        airBusy = host_radio.tx_active || answerExpected();
+        heldAt = chan_held();
+        waitBoundMs = igniteWaitBound();
+        press(BUTTON_IGNITE, 1);
+        while (ignite_led(1, 1) && des_now() - igniteAt < FIRE_TIMEOUT_MS * MS) {
+            if (des_now() - igniteAt >= REACTION_MS * MS) press(BUTTON_IGNITE, 0);
+            des_wait_ns(MS);
+        }
+        /* a retry held back past the budget: the pads still on fast poll hear it with the wake
+           preamble and must only answer it */
+        if (repeatMs && igniteAirAt) {
+            while (des_now() < igniteAirAt + repeatMs * MS) des_wait_ns(MS);
+            uint16_t preamble = proto_wake_preamble(adr_rate());
+            uint64_t air = proto_frame_us(adr_rate(), preamble) * 1000ULL;
+            repeatsHeard += link_controller_repeat(igniteBuf, igniteLen, preamble, des_now() - air, des_now());
+            des_wait_ns(2 * PROTO_RELAY_MS * MS);
+        }
+        /* with a heartbeat on air, or its answer, or someone else on the channel,
+           the IGNITE has to wait, up to the controller's bound */
+        if (igniteAirAt) {
+            double ms = (igniteAirAt - igniteAt) / 1e6;
+            uint8_t waited = airBusy || chan_held() != heldAt;
+            series_add(&igniteAir, igniteAirAt - igniteAt);
+            if (waited) series_add(&igniteWait, igniteAirAt - igniteAt);
+            if (ms > BOUND_IGNITE_MS + (waited ? waitBoundMs : 0)) igniteOver++;
+        }
+        if (relayAt) series_add(&igniteRelay, relayAt - igniteAt);
+        if (relayPads == selected && pads > 1) series_add(&relaySpread, relayLastAt - relayAt);
+        for (uint8_t i = 0; i < RECEIVER_COUNT; i++) {
+            if (relayFires[i] > 1) firedTwice++;
+        }
+        /* given up on, the IGNITE LED blinks red */
+        if (igniteUnanswered) {
+            noReply++;
+        } else if (ignite_led(1, 0)) {
+            done++;
+            if (relayPads != selected) notAll++;
+            series_add(&igniteDone, des_now() - igniteAt);
+            series_add(&armDone, des_now() - armAt);
+        } else if (ignite_led(0, 1)) {
+            refused++;
+        } else {
+            noReply++;
+        }
+        press(BUTTON_IGNITE, 0);
+        press(BUTTON_ARM, 0);
+    }
+    finished = 1;
+    while (1) des_wait_ns(1000 * MS);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-n trials] [-l loss 0..1] [-r rssi dBm at 20 dBm] [-j jitter dB] [-p pads 1..8] [-s pad]\n"
+                    "       [-d controller ppm] [-D receiver ppm] [-o open igniter] [-c clip off/on ms]\n"
+                    "       [-i interferer channel[,from s]] [-I interferer dBm] [-S seed] [-b check bounds] [-v]\n"
+                    "       [-x radio crystal ppm[,ppm per min]] [-R late IGNITE repeat ms] [-t console capture file]\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    link_config_t link = {1, 0.0, -90, 3, controller_tx, 0, {0}};
+    link.interferer.rssi = INTERFERER_RSSI;
+    link.interferer.on_ms = INTERFERER_ON_MS;
+    link.interferer.period_ms = INTERFERER_PERIOD_MS;
+    int interfererChannel = -1;
+    double interfererFrom = 0;
+    receiver_config_t receiver = {0, 600, on_relay};
+    int32_t controllerPpm = 0;
+    uint8_t checkBounds = 0;
+    FILE *capture = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:l:r:j:p:s:d:D:oc:i:I:x:R:S:bvt:")) != -1) {
+        switch (opt) {
+            case 'n': trials = atoi(optarg); break;
+            case 'l': link.loss = atof(optarg); break;
+            case 'r': link.rssi = atoi(optarg); break;
+            case 'j': link.rssi_jitter = atoi(optarg); break;
+            case 'p': pads = atoi(optarg); break;
+            case 's': selectPad = atoi(optarg); break;
+            case 'd': controllerPpm = atoi(optarg); break;
+            case 'D': receiver.clock_ppm = atoi(optarg); break;
+            case 'o': receiver.adc = 0; break;
+            case 'c': clipMs = atoi(optarg); break;
+            case 'i':
+                if (sscanf(optarg, "%d,%lf", &interfererChannel, &interfererFrom) < 1) usage(argv[0]);
+                break;
+            case 'I': link.interferer.rssi = atoi(optarg); break;
+            case 'x':
+                if (sscanf(optarg, "%lf,%lf", &link.xtal_ppm, &link.xtal_ppm_per_min) < 1) usage(argv[0]);
+                break;
+            case 'R': repeatMs = atoi(optarg); break;
+            case 'S': link.seed = atoi(optarg); break;
+            case 'b': checkBounds = 1; break;
+            case 'v': host_uart_echo(1); break;
+            case 't':
+                capture = fopen(optarg, "wb");
+                if (!capture) {
+                    perror(optarg);
+                    exit(2);
+                }
+                break;
+            default: usage(argv[0]);
+        }
+    }
+
+    if (pads < 1 || pads > RECEIVER_COUNT || selectPad > pads) usage(argv[0]);
+    if (interfererChannel >= PROTO_CHANNEL_COUNT || interfererFrom < 0) usage(argv[0]);
+    if (interfererChannel >= 0) {
+        link.interferer.freq_hz = proto_channel_hz(interfererChannel);
+        link.interferer.from_ms = interfererFrom * 1000;
+    }
+    padsFitted = link.pads = (1 << pads) - 1;
+
+    host_reset();
+    host_set_clock_ppm(controllerPpm);
+    host_uart_capture(capture);
+    host_set_wait_hook(controller_wait);
+    host_set_wake_hook(controller_wake);
+    link_init(&link);
+    for (uint8_t i = 0; i < pads; i++) {
+        receivers[i]->init(&receiver);
+    }
+
+    controller = des_spawn("controller", controller_task, 0);
+    for (uint8_t i = 0; i < pads; i++) {
+        des_spawn("receiver", receivers[i]->task, 0);
+        des_spawn("adc", receivers[i]->adc_task, 0);
+    }
+    des_spawn("monitor", monitor_task, 0);
+    des_spawn("operator", operator_task, 0);
+    clipAdc = receiver.adc;
+    if (clipMs) des_spawn("clip", clip_task, 0);
+    while (!finished) {
+        des_run_until(des_now() + 1000 * MS);
+    }
+
+    toa_config_t toa;
+    toa_default_config(&toa);
+    printf("%u trials, loss %.1f%%, rssi %d +/-%u dBm at 20 dBm, clocks %+d/%+d ppm, igniter %s, seed %u\n",
+           trials, link.loss * 100, link.rssi, link.rssi_jitter, controllerPpm,
+           receiver.clock_ppm, receiver.adc ? "connected" : "open", link.seed);
+    if (pads > 1) {
+        printf("%u pads, firing %s\n", pads, selectPad ? "one" : "all");
+    }
+    if (interfererChannel >= 0) {
+        printf("interferer on channel %d from %.1f s: %u ms of %u ms at %d dBm\n", interfererChannel,
+               interfererFrom, INTERFERER_ON_MS, INTERFERER_PERIOD_MS, link.interferer.rssi);
+    }
+    if (link.xtal_ppm || link.xtal_ppm_per_min) {
+        printf("controller radio crystal %+.1f ppm, drifting %+.1f ppm a minute\n", link.xtal_ppm,
+               link.xtal_ppm_per_min);
+    }
+    printf("time on air at the default rate: ping %.2f ms, status %.2f ms\n\n",
+           toa_packet_us(&toa, PROTO_HEADER_LEN + proto_body_len(PROTO_OP_PING)) / 1000.0,
+           toa_packet_us(&toa, PROTO_HEADER_LEN + proto_body_len(PROTO_OP_STATUS)) / 1000.0);
+
+    printf("%-24s %6s %8s %8s %8s %8s %8s %8s\n", "ms", "n", "min", "p50", "p90", "p99", "max", "mean");
+    series_print("arm -> armed LED", &armReady);
+    series_print("ignite -> IGNITE on air", &igniteAir);
+    series_print("  after waiting", &igniteWait);
+    series_print("ignite -> relay", &igniteRelay);
+    series_print("ignite -> IGNITED", &igniteDone);
+    series_print("arm -> IGNITED", &armDone);
+    series_print("STATUS age at ignite", &statusAge);
+    series_print("STATUS interval per pad", &statusGap);
+    if (pads > 1) series_print("first -> last relay", &relaySpread);
+    if (clipMs) {
+        series_print("clip off -> receiver", &clipOff);
+        series_print("clip on -> receiver", &clipOn);
+        series_print("clip off -> controller", &clipOffLed);
+        series_print("clip on -> controller", &clipOnLed);
+    }
+
+    uint64_t now = des_now();
+    if (!hasConnection) downNs += now - downSince;
+    double seconds = (now - monitorFrom) / 1e9;
+    printf("\noutcome: %u ignited, %u refused, %u no reply, %u not armed (no connection)\n",
+           done, refused, noReply, notArmed);
+    printf("IGNITE retries: %u, relay fired more than once: %u\n", igniteRetries, firedTwice);
+    if (repeatMs) printf("IGNITE repeated %u ms after the first: taken by %u pads\n", repeatMs, repeatsHeard);
+    if (pads > 1) printf("IGNITED without every selected relay firing: %u\n", notAll);
+    if (selectPad) printf("selection after a tap and %u long presses: pads %02x %s\n", selectPad, selectedPads,
+                          selectWrong ? "FAIL" : "ok");
+    uint8_t slots = beatSlots();
+    printf("status bound: %u of %u pads a heartbeat, each within %lu ms unless answers go missing\n",
+           slots, pads, (unsigned long) statusBound());
+    printf("false no connection: %u drops in %.0f s, %.2f%% of the time\n",
+           drops, seconds, seconds > 0 ? downNs / 1e7 / seconds : 0.0);
+
+    link_stats_t stats;
+    link_stats(&stats);
+    printf("packets: controller -> receiver %u sent, %u lost, %u other rate, %u missed; "
+           "receiver -> controller %u sent, %u lost, %u other rate, %u missed, %u collided\n",
+           stats.down.sent, stats.down.lost, stats.down.mismatched, stats.down.missed,
+           stats.up.sent, stats.up.lost, stats.up.mismatched, stats.up.missed, stats.up.collided);
+    lora_rx_stats_t rx;
+    lora_rx_stats(&rx);
+    printf("controller receive queue: %u packets, peak %u of %u, %u overflow, %u missed in the radio, %u crc errors\n",
+           rx.received, rx.peak, LORA_RX_QUEUE, rx.overflow, rx.missed, rx.crc_errors);
+    host_stats_t host;
+    host_stats(&host);
+    printf("controller console: %u bytes, %.1f per packet received, %u dropped\n", host.uart_bytes,
+           rx.received ? (double) host.uart_bytes / rx.received : 0.0, uart_tx_dropped());
+    if (interfererChannel >= 0) {
+        printf("jammed by the interferer: %u controller -> receiver, %u receiver -> controller\n",
+               stats.down.jammed, stats.up.jammed);
+    }
+    printf("ignite waited for a heartbeat, its answer or a busy channel: %u of %u, up to %.1f ms, "
+           "bound %lu ms at the end rate\n", igniteWait.count, igniteAir.count,
+           igniteWait.count ? igniteWait.values[igniteWait.count - 1] : 0.0, (unsigned long) igniteWaitBound());
+    printf("channel at the end: %u (%.1f MHz), busy", adr_channel(), proto_channel_hz(adr_channel()) / 1e6);
+    for (uint8_t ch = 0; ch < PROTO_CHANNEL_COUNT; ch++) {
+        if (chan_busy(ch) == 0xFF) printf(" -");
+        else printf(" %u%%", chan_busy(ch));
+    }
+    printf("; listen before talk held back %u packets, sent %u busy\n", chan_held(), chan_forced());
+    printf("link at the end: rate %u (SF%u, %lu kHz), %u dBm, margin %d dB\n",
+           adr_rate(), proto_rate_sf(adr_rate()), (unsigned long) proto_rate_bw_hz(adr_rate()) / 1000,
+           adr_power(), adr_margin());
+    printf("frequency at the end: controller %+ld Hz off the pads, correcting %+ld Hz after %u retunes, %u undone\n",
+           (long) link_controller_freq_hz() - (long) proto_channel_hz(adr_channel()),
+           (long) lora_freq_correction(), afc_retunes(), afc_undone());
+    double radioMa = 0;
+    for (uint8_t i = 0; i < pads; i++) radioMa += receivers[i]->radio_ma();
+    printf("receiver radio: %.3f mA average (wake every %u ms, %u symbol preamble at the end rate)\n",
+           radioMa / pads, PROTO_WAKE_MS, proto_wake_preamble(adr_rate()));
+    if (capture) fclose(capture);
+    if (selectWrong) return 1;
+
+    if (checkBounds) {
+        /* armed LED polled every millisecond, so up to 1 ms of that is the operator */
+        uint8_t armOk = armReady.count && armReady.values[0] >= ARM_HOLD_MS
+                        && armReady.values[armReady.count - 1] <= ARM_HOLD_MS + BOUND_ARM_MS;
+        uint8_t igniteOk = igniteAir.count && !igniteOver;
+        printf("bounds: arm hold %s (%u..%u ms), ignite -> on air %s (<= %u ms, after waiting <= %u ms more, "
+               "%u of %u over)\n", armOk ? "ok" : "FAIL", ARM_HOLD_MS, ARM_HOLD_MS + BOUND_ARM_MS,
+               igniteOk ? "ok" : "FAIL", BOUND_IGNITE_MS, (unsigned) igniteWaitBound(), igniteOver, igniteAir.count);
+        if (!armOk || !igniteOk) return 1;
+        /* PROTO_IGNITE_LATE_MS is worked out at compile time from the slowest rate's symbol */
+        if (PROTO_SLOWEST_SYMBOL_US != proto_rate_symbol_us(PROTO_RATE_ROBUST)) {
+            printf("bounds: PROTO_SLOWEST_SYMBOL_US FAIL (%lu us, the robust rate's is %lu us)\n",
+                   PROTO_SLOWEST_SYMBOL_US, (unsigned long) proto_rate_symbol_us(PROTO_RATE_ROBUST));
+            return 1;
+        }
+        if (repeatMs) {
+            uint8_t repeatOk = repeatsHeard && !firedTwice;
+            printf("bounds: late IGNITE repeat %s (%u taken, relay fired again %u times)\n", repeatOk ? "ok" : "FAIL",
+                   repeatsHeard, firedTwice);
+            if (!repeatOk) return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+SPI cost of the radio driver, measured against the simulated SX127x.
+
+For each driver operation prints CS windows, SPI bytes and simulated time.
+The time runs until the call returned: SPI transactions it queued go on
+from the interrupt after that, their bytes count all the same.
+Run it before and after a driver change and compare. With -c it also
+checks the counts against the expected ones below and exits with status 1
+if any went up; make check runs it so. A driver change that saves SPI
+traffic lowers the numbers here as well.
+
+    ./lora_bench [-c]
+*/
+
+#include "hal.h"
+#include "host.h"
+#include "lora.h"
+#include "spi.h"
+#include "proto.h"
+
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    const char *name;
+    uint32_t spi_transactions;
+    uint32_t spi_bytes;
+} expected_t;
+
+static const expected_t expected[] = {
+    {"lora_init",               14, 44},
+    {"lora_set_freq",           1,  4},
+    {"lora_apply_config (same)", 0,  0},
+    {"reconfigure",             2,  4},
+    {"retune (channel)",        2,  4},
+    {"lora_rssi",               1,  2},
+    {"lora_verify_config",      5,  21},
+    {"lora_send_async (ping)",  6,  17},
+    {"lora_send (ignite)",      9,  23},
+    {"lora_receive (status)",   5,  28},
+};
+
+static host_stats_t before;
+static uint8_t check;
+static uint8_t failed;
+
+static void begin() {
+    host_stats(&before);
+}
+
+static void end(const char *name) {
+    uint64_t returned = host_now_ns();
+    spi_flush();
+    host_stats_t after;
+    host_stats(&after);
+    after.time_ns = returned;
+    uint32_t transactions = after.spi_transactions - before.spi_transactions;
+    uint32_t bytes = after.spi_bytes - before.spi_bytes;
+    printf("%-24s %6u %6u %10.1f", name, transactions, bytes, (after.time_ns - before.time_ns) / 1000.0);
+    if (check) {
+        const expected_t *e = NULL;
+        for (uint8_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+            if (strcmp(expected[i].name, name) == 0) e = &expected[i];
+        }
+        if (!e) {
+            printf("  no expected counts");
+            failed = 1;
+        } else if (transactions > e->spi_transactions || bytes > e->spi_bytes) {
+            printf("  FAIL, expected %u %u", e->spi_transactions, e->spi_bytes);
+            failed = 1;
+        } else if (transactions < e->spi_transactions || bytes < e->spi_bytes) {
+            printf("  below %u %u, lower the expected counts", e->spi_transactions, e->spi_bytes);
+        }
+    }
+    printf("\n");
+}
+
+static uint8_t frame(uint8_t op, uint8_t *out) {
+    proto_frame_t f = {PROTO_ADDR_BROADCAST, PROTO_ADDR_BROADCAST, 0, 0, op, proto_status(1, PROTO_BATT_UNKNOWN)};
+    return proto_encode(&f, out);
+}
+
+int main(int argc, char **argv) {
+    uint8_t packet[PROTO_MAX_FRAME];
+    uint8_t len;
+
+    if (argc == 2 && strcmp(argv[1], "-c") == 0) {
+        check = 1;
+    } else if (argc != 1) {
+        fprintf(stderr, "usage: %s [-c]\n", argv[0]);
+        return 2;
+    }
+
+    host_reset();
+    printf("%-24s %6s %6s %10s\n", "operation", "cs", "bytes", "us");
+
+    begin();
+    if (lora_init() != ECODE_OK) {
+        printf("lora_init failed\n");
+        return 1;
+    }
+    end("lora_init");
+    hal_irq_restore(1);
+
+    /* 868.1 MHz differs from FREQUENCY in all three FRF registers, they go out in one burst.
+       Applied again with nothing changed there is nothing to write */
+    lora_standby();
+    begin();
+    lora_set_freq(868100000);
+    lora_apply_config();
+    end("lora_set_freq");
+    begin();
+    lora_apply_config();
+    end("lora_apply_config (same)");
+    lora_set_freq(FREQUENCY);
+    lora_apply_config();
+
+    /* what a link adaptation step changes */
+    begin();
+    lora_standby();
+    lora_set_spreading_factor(10);
+    lora_set_bandwidth(BANDWIDTH_250_KHZ);
+    lora_tx_power(14);
+    lora_set_preamble_length(PROTO_PREAMBLE_SHORT);
+    lora_apply_config();
+    end("reconfigure");
+
+    /* what a channel change and a listen before talk check cost */
+    begin();
+    lora_standby();
+    lora_set_freq(proto_channel_hz(1));
+    lora_apply_config();
+    end("retune (channel)");
+
+    begin();
+    lora_rssi(proto_channel_hz(1));
+    end("lora_rssi");
+
+    begin();
+    lora_verify_config();
+    end("lora_verify_config");
+
+    len = frame(PROTO_OP_PING, packet);
+    begin();
+    lora_send_async(packet, len, 0);
+    end("lora_send_async (ping)");
+    while (lora_tx_busy()) {
+        hal_idle();
+        lora_receive();
+    }
+
+    len = frame(PROTO_OP_IGNITE, packet);
+    begin();
+    lora_send(packet, len);
+    end("lora_send (ignite)");
+
+    len = frame(PROTO_OP_STATUS, packet);
+    lora_packet_t received;
+    sx127x_receive(&host_radio, packet, len, PROTO_PREAMBLE_SHORT, -60, 9, 0, 0, host_now_ns());
+    while (1) {
+        hal_idle();
+        if (lora_tx_busy() == 0 && host_radio.rx_pending[0] == 0) {
+            begin();
+            lora_receive();
+            if (lora_rx_pop(&received) == ECODE_OK) {
+                end("lora_receive (status)");
+                break;
+            }
+        }
+    }
+
+    /* two packets in before lora_receive() runs: the second overwrites the first in the radio */
+    sx127x_receive(&host_radio, packet, len, PROTO_PREAMBLE_SHORT, -60, 9, 0, 0, host_now_ns());
+    sx127x_receive(&host_radio, packet, len, PROTO_PREAMBLE_SHORT, -60, 9, 0, 0, host_now_ns());
+    while (host_radio.rx_pending[0] || host_radio.rx_pending[1]) hal_idle();
+    lora_receive();
+    while (lora_rx_pop(&received) == ECODE_OK) {}
+
+    lora_rx_stats_t rx;
+    lora_rx_stats(&rx);
+    printf("radio: %u sent, %u received, %u missed\n", host_radio.tx_packets, host_radio.rx_packets, host_radio.rx_missed);
+    printf("driver: %u received, %u missed in the radio, %u overflow\n", rx.received, rx.missed, rx.overflow);
+    if (check) printf("spi: %s\n", failed ? "FAIL" : "ok");
+    return failed;
+}
@@ -0,0 +1,353 @@
+/*
+Receiver node for link_sim: the unmodified sketch on the Arduino and
+RadioHead stand-ins, running as a discrete-event task.
+
+Built once per pad with -DPAD_ID=n: everything here, the stand-ins
+included, goes in namespace padn, and receiver_n hands it to link.c.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "../itsy-bitsy/proto.h"
+#include "receiver.h"
+
+extern "C" {
+#include "des.h"
+#include "link.h"
+#include "toa.h"
+}
+
+#define PASTE_(a, b)    a##b
+#define PASTE(a, b)     PASTE_(a, b)
+
+namespace PASTE(pad, PAD_ID) {
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <RH_RF95.h>
+
+/* the sketch gets its own namespace, its globals share names with the controller's */
+namespace sketch {
+#include "../itsy-bitsy/itsy-bitsy.ino"
+}
+
+// One pass of loop() with nothing to do, 16 MHz ATmega32U4
+#define RECEIVER_LOOP_NS        20000
+// Longest idle stretch between loop() passes, a packet wakes it early
+#define RECEIVER_IDLE_NS        1000000
+// RadioHead's interrupt handler reading the packet out over SPI
+#define RECEIVER_RX_IRQ_NS      150000
+// send(): mode changes and the FIFO write over SPI before TX starts
+#define RECEIVER_TX_SETUP_NS    250000
+// 13 ADC clocks at 125 kHz
+#define RECEIVER_ADC_NS         104000
+// Noise on each conversion, +/- counts
+#define RECEIVER_ADC_NOISE      4
+// Until the sketch starts the ADC, look again this often
+#define RECEIVER_ADC_IDLE_NS    1000000
+
+SerialPort Serial;
+volatile uint8_t ADMUX, ADCSRA, ADCSRB, DIDR0;
+volatile uint16_t ADC;
+
+static receiver_config_t config;
+static des_task_t *task;
+static uint8_t idle; // between loop() passes, safe to wake early
+static RH_RF95 *radio;
+static uint32_t noise = 1; // xorshift32, apart from the link's so the ADC leaves its draws alone
+
+/* local time on the receiver's crystal */
+static uint64_t local_ns() {
+    int64_t ns = des_now();
+    return ns + ns * config.clock_ppm / 1000000;
+}
+
+static uint64_t global_ns(uint64_t local) {
+    int64_t ns = local;
+    return ns - ns * config.clock_ppm / (1000000 + config.clock_ppm);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+static uint8_t pins[32];
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+    if (pin == RELAY_PIN && level != pins[pin] && config.on_relay) {
+        config.on_relay(PAD_ID, level);
+    }
+    pins[pin] = level;
+}
+
+int digitalRead(uint8_t pin) {
+    return pins[pin];
+}
+
+/* the reading with a little noise, within 0..1023 */
+static uint16_t adc_sample() {
+    noise ^= noise << 13;
+    noise ^= noise >> 17;
+    noise ^= noise << 5;
+    int32_t sample = config.adc - RECEIVER_ADC_NOISE + (int32_t) (noise % (2 * RECEIVER_ADC_NOISE + 1));
+    if (sample < 0) return 0;
+    if (sample > 1023) return 1023;
+    return sample;
+}
+
+unsigned long millis() {
+    return local_ns() / 1000000;
+}
+
+unsigned long micros() {
+    return local_ns() / 1000;
+}
+
+void delay(unsigned long ms) {
+    des_wait_ns(global_ns((uint64_t) ms * 1000000));
+}
+
+void delayMicroseconds(unsigned int us) {
+    des_wait_ns(global_ns((uint64_t) us * 1000));
+}
+
+RH_RF95::RH_RF95(uint8_t slaveSelectPin, uint8_t interruptPin) {
+    radio = this;
+    _mode = RHModeIdle;
+    _crc = true;
+    _preamble = 8;
+    _sf = 7;
+    _bw = 125000;
+    _freq = 434000000;
+    _power = 13;
+    _rxBufValid = false;
+    _thisAddress = RH_BROADCAST_ADDRESS;
+    _promiscuous = false;
+    _txHeaderTo = RH_BROADCAST_ADDRESS;
+    _txHeaderFrom = RH_BROADCAST_ADDRESS;
+    _txHeaderId = 0;
+    _txHeaderFlags = 0;
+}
+
+bool RH_RF95::init() {
+    setModeIdle();
+    return true;
+}
+
+bool RH_RF95::setFrequency(float centre) {
+    _freq = (uint32_t) (centre * 1000000.0 + 0.5);
+    return true;
+}
+
+void RH_RF95::setPayloadCRC(bool on) {
+    _crc = on;
+}
+
+void RH_RF95::setTxPower(int8_t power, bool useRFO) {
+    if (power < 2) power = 2;
+    if (power > 20) power = 20;
+    _power = power;
+}
+
+void RH_RF95::setPreambleLength(uint16_t bytes) {
+    _preamble = bytes;
+}
+
+void RH_RF95::setSpreadingFactor(uint8_t sf) {
+    _sf = sf;
+}
+
+void RH_RF95::setSignalBandwidth(long sbw) {
+    _bw = sbw;
+}
+
+void RH_RF95::setHeaderFlags(uint8_t set, uint8_t clear) {
+    _txHeaderFlags &= ~clear;
+    _txHeaderFlags |= set;
+}
+
+/* TxDone interrupt: back to idle */
+void RH_RF95::updateMode() {
+    if (_mode == RHModeTx && des_now() >= _txEnd) {
+        _mode = RHModeIdle;
+    }
+}
+
+void RH_RF95::setModeIdle() {
+    _mode = RHModeIdle;
+}
+
+void RH_RF95::setModeRx() {
+    if (_mode != RHModeRx) {
+        _mode = RHModeRx;
+        _rxSince = des_now();
+    }
+}
+
+bool RH_RF95::sleep() {
+    _mode = RHModeSleep;
+    return true;
+}
+
+/* CadDone after PROTO_CAD_SYMBOLS, RadioHead waits for it */
+bool RH_RF95::isChannelActive() {
+    link_modem_t modem = {_sf, (uint32_t) _bw, _power, _freq};
+    uint64_t start = des_now();
+    _mode = RHModeCad;
+    des_wait_ns(((1000000000ULL << _sf) / _bw) * PROTO_CAD_SYMBOLS);
+    _mode = RHModeIdle;
+    return link_channel_active(&modem, start, des_now());
+}
+
+/* RegRssiValue: -164 dBm + the value on the LF port */
+uint8_t RH_RF95::spiRead(uint8_t reg) {
+    if (reg != RH_RF95_REG_1B_RSSI_VALUE || _mode != RHModeRx) return 0;
+    link_modem_t modem = {_sf, (uint32_t) _bw, _power, _freq};
+    int16_t value = link_channel_rssi(&modem, des_now()) + 164;
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+bool RH_RF95::available() {
+    updateMode();
+    if (_mode == RHModeTx) return false;
+    setModeRx();
+    return _rxBufValid;
+}
+
+bool RH_RF95::recv(uint8_t *buf, uint8_t *len) {
+    if (!available()) return false;
+    uint8_t body = _bufLen - RH_RF95_HEADER_LEN;
+    if (*len > body) *len = body;
+    memcpy(buf, _buf + RH_RF95_HEADER_LEN, *len);
+    _rxBufValid = false;
+    return true;
+}
+
+bool RH_RF95::send(const uint8_t *data, uint8_t len) {
+    if (len > RH_RF95_MAX_MESSAGE_LEN) return false;
+    waitPacketSent();
+    setModeIdle();
+    uint8_t packet[RH_RF95_MAX_MESSAGE_LEN + RH_RF95_HEADER_LEN];
+    packet[0] = _txHeaderTo;
+    packet[1] = _txHeaderFrom;
+    packet[2] = _txHeaderId;
+    packet[3] = _txHeaderFlags;
+    memcpy(packet + RH_RF95_HEADER_LEN, data, len);
+    des_wait_ns(RECEIVER_TX_SETUP_NS);
+
+    toa_config_t toa;
+    toa_default_config(&toa);
+    toa.sf = _sf;
+    toa.bandwidth = _bw >= 500000 ? BANDWIDTH_500_KHZ : _bw >= 250000 ? BANDWIDTH_250_KHZ : BANDWIDTH_125_KHZ;
+    toa.crc = _crc;
+    toa.preamble = _preamble;
+    _mode = RHModeTx;
+    _txEnd = des_now() + (uint64_t) toa_packet_us(&toa, len + RH_RF95_HEADER_LEN) * 1000;
+    link_modem_t modem = {_sf, (uint32_t) _bw, _power, _freq};
+    link_from_receiver(packet, len + RH_RF95_HEADER_LEN, &modem, _preamble, des_now(), _txEnd);
+    return true;
+}
+
+bool RH_RF95::waitPacketSent() {
+    if (_mode == RHModeTx) {
+        des_wait_until(_txEnd);
+    }
+    updateMode();
+    return true;
+}
+
+bool RH_RF95::deliver(const uint8_t *buf, uint8_t len, int16_t rssi, int8_t snr, uint64_t lock_ns) {
+    updateMode();
+    if (_mode != RHModeRx || _rxSince > lock_ns || len < RH_RF95_HEADER_LEN) {
+        return false;
+    }
+    /* RadioHead drops packets addressed elsewhere */
+    if (!_promiscuous && buf[0] != _thisAddress && buf[0] != RH_BROADCAST_ADDRESS) {
+        return true;
+    }
+    memcpy(_buf, buf, len);
+    _bufLen = len;
+    _rxHeaderTo = buf[0];
+    _rxHeaderFrom = buf[1];
+    _rxHeaderId = buf[2];
+    _rxHeaderFlags = buf[3];
+    _lastRssi = rssi;
+    _lastSNR = snr;
+    _rxBufValid = true;
+    _mode = RHModeIdle;
+    return true;
+}
+
+static void receiver_init(const receiver_config_t *receiver_config) {
+    config = *receiver_config;
+    memset(pins, 0, sizeof(pins));
+    ADCSRA = 0;
+    noise = PAD_ID;
+}
+
+static void receiver_task(void *arg) {
+    task = des_current();
+    sketch::setup();
+    while (1) {
+        sketch::loop();
+        des_wait_ns(RECEIVER_LOOP_NS);
+        idle = 1;
+        des_wait_ns(RECEIVER_IDLE_NS);
+        idle = 0;
+    }
+}
+
+/* free running with the interrupt enabled: a conversion every RECEIVER_ADC_NS */
+static void receiver_adc_task(void *arg) {
+    const uint8_t running = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE);
+    while (1) {
+        if ((ADCSRA & running) != running) {
+            des_wait_ns(RECEIVER_ADC_IDLE_NS);
+            continue;
+        }
+        des_wait_ns(RECEIVER_ADC_NS);
+        ADC = adc_sample();
+        sketch::ADC_vect();
+    }
+}
+
+static void receiver_set_adc(uint16_t adc) {
+    config.adc = adc;
+}
+
+static uint8_t receiver_continuity() {
+    return sketch::continuity;
+}
+
+static void receiver_modem(link_modem_t *modem) {
+    modem->sf = radio->spreadingFactor();
+    modem->bw_hz = radio->signalBandwidth();
+    modem->power = radio->txPower();
+    modem->freq_hz = radio->frequency();
+}
+
+static uint8_t receiver_deliver(const uint8_t *buf, uint8_t len, int16_t rssi, int8_t snr, uint64_t lock_ns) {
+    if (!radio->deliver(buf, len, rssi, snr, lock_ns)) return 0;
+    if (idle) des_wake(task, des_now() + RECEIVER_RX_IRQ_NS);
+    return 1;
+}
+
+static double receiver_radio_ma() {
+    return sketch::radioAverageMa;
+}
+
+} // namespace
+
+extern "C" const receiver_t PASTE(receiver_, PAD_ID) = {
+    PAD_ID,
+    PASTE(pad, PAD_ID)::receiver_init,
+    PASTE(pad, PAD_ID)::receiver_task,
+    PASTE(pad, PAD_ID)::receiver_adc_task,
+    PASTE(pad, PAD_ID)::receiver_set_adc,
+    PASTE(pad, PAD_ID)::receiver_continuity,
+    PASTE(pad, PAD_ID)::receiver_deliver,
+    PASTE(pad, PAD_ID)::receiver_modem,
+    PASTE(pad, PAD_ID)::receiver_radio_ma,
+};
+
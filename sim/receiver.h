@@ -0,0 +1,57 @@
+#ifndef __RECEIVER_H_
+#define __RECEIVER_H_
+
+/*
+The receiver sketch (itsy-bitsy/itsy-bitsy.ino) built for link_sim,
+running on the Arduino and RadioHead stand-ins in shim/
+
+receiver.cpp is built once per pad number, with its PAD_ID, each build in
+a namespace of its own, so every pad runs its own copy of the sketch and
+the stand-ins. receivers[] holds them, pad 1 first.
+*/
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "link.h"
+
+// Builds of the sketch, pads 1 to PROTO_PAD_MAX
+#define RECEIVER_COUNT          8
+
+typedef struct {
+    int32_t clock_ppm;      // crystal error, skews millis() and delay()
+    uint16_t adc;           // continuity input reading, ADC_THRESH and above is a connected igniter
+    void (*on_relay)(uint8_t pad, uint8_t on);
+} receiver_config_t;
+
+typedef struct {
+    uint8_t pad;
+    void (*init)(const receiver_config_t *config);
+    // Task body: setup(), then loop() forever
+    void (*task)(void *arg);
+    // Task body: the free-running ADC, the sketch's conversion interrupt every RECEIVER_ADC_NS once started
+    void (*adc_task)(void *arg);
+    // Change the continuity input, e.g. a clip coming off
+    void (*set_adc)(uint16_t adc);
+    // The sketch's filtered continuity state
+    uint8_t (*continuity)();
+    // Packet from the link, called when its last symbol is in; 0 if the radio was not listening by 'lock_ns'
+    uint8_t (*deliver)(const uint8_t *buf, uint8_t len, int16_t rssi, int8_t snr, uint64_t lock_ns);
+    // Data rate, TX power and frequency the sketch has set
+    void (*modem)(link_modem_t *modem);
+    // The sketch's estimate of its average radio current since power-up, mA
+    double (*radio_ma)();
+} receiver_t;
+
+extern const receiver_t receiver_1, receiver_2, receiver_3, receiver_4,
+                        receiver_5, receiver_6, receiver_7, receiver_8;
+extern const receiver_t *const receivers[RECEIVER_COUNT];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RECEIVER_H_ */
@@ -0,0 +1,59 @@
+#ifndef __SHIM_ARDUINO_H_
+#define __SHIM_ARDUINO_H_
+
+/*
+Just enough of the Arduino core to run the receiver sketch
+(itsy-bitsy/itsy-bitsy.ino) inside link_sim. Time comes from the
+discrete-event core, skewed by the receiver's crystal error; see receiver.cpp.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HIGH    1
+#define LOW     0
+#define INPUT   0
+#define OUTPUT  1
+#define DEC     10
+#define HEX     16
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+// Interrupts never nest with loop() in the simulation
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+#define _BV(bit)    (1 << (bit))
+#define ISR(vector) void vector(void)
+
+// ATmega32U4 ADC registers. receiver_adc_task() runs the conversions
+extern volatile uint8_t ADMUX, ADCSRA, ADCSRB, DIDR0;
+extern volatile uint16_t ADC;
+
+#define REFS0   6
+#define ADEN    7
+#define ADSC    6
+#define ADATE   5
+#define ADIE    3
+#define ADPS2   2
+#define ADPS1   1
+#define ADPS0   0
+#define ADC5D   5
+
+// Console output is dropped, printing costs nothing on the simulated USB serial
+class SerialPort {
+public:
+    void begin(long baud) {}
+    template <class T> void print(T value, int base = DEC) {}
+    template <class T> void println(T value, int base = DEC) {}
+    void println() {}
+};
+
+extern SerialPort Serial;
+
+#endif /* __SHIM_ARDUINO_H_ */
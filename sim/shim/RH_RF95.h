@@ -0,0 +1,94 @@
+#ifndef __SHIM_RH_RF95_H_
+#define __SHIM_RH_RF95_H_
+
+/*
+Packet-level stand-in for the RadioHead RH_RF95 driver
+
+Follows the library's mode handling: available() puts the radio in
+receive unless it is transmitting, a received packet is held in a single
+buffer (a later one overwrites it), send() waits for the previous packet
+and transmits the 4 byte header (to, from, id, flags) ahead of the data,
+and TxDone drops back to idle. isChannelActive() runs a CAD and leaves
+the radio idle; sleep() keeps it off until the next mode change. Of the
+registers spiRead() only has RegRssiValue, read in receive. Packets go
+through the link model in link.c.
+*/
+
+#include <Arduino.h>
+
+#define RH_RF95_MAX_MESSAGE_LEN     251
+#define RH_RF95_HEADER_LEN          4
+#define RH_BROADCAST_ADDRESS        0xff
+#define RH_FLAGS_APPLICATION_SPECIFIC 0x0f
+#define RH_RF95_REG_1B_RSSI_VALUE   0x1b
+
+class RH_RF95 {
+public:
+    typedef enum { RHModeSleep, RHModeIdle, RHModeRx, RHModeTx, RHModeCad } RHMode;
+
+    RH_RF95(uint8_t slaveSelectPin, uint8_t interruptPin);
+
+    bool init();
+    bool setFrequency(float centre);
+    void setPayloadCRC(bool on);
+    void setTxPower(int8_t power, bool useRFO);
+    void setPreambleLength(uint16_t bytes);
+    void setSpreadingFactor(uint8_t sf);
+    void setSignalBandwidth(long sbw);
+
+    bool available();
+    bool recv(uint8_t *buf, uint8_t *len);
+    bool send(const uint8_t *data, uint8_t len);
+    bool waitPacketSent();
+    void setModeIdle();
+    void setModeRx();
+    bool sleep();
+    bool isChannelActive();
+    uint8_t spiRead(uint8_t reg);
+
+    int16_t lastRssi() { return _lastRssi; }
+    int lastSNR() { return _lastSNR; }
+    uint8_t headerTo() { return _rxHeaderTo; }
+    uint8_t headerFrom() { return _rxHeaderFrom; }
+    uint8_t headerId() { return _rxHeaderId; }
+    uint8_t headerFlags() { return _rxHeaderFlags; }
+    void setHeaderTo(uint8_t to) { _txHeaderTo = to; }
+    void setHeaderFrom(uint8_t from) { _txHeaderFrom = from; }
+    void setHeaderId(uint8_t id) { _txHeaderId = id; }
+    void setHeaderFlags(uint8_t set, uint8_t clear = RH_FLAGS_APPLICATION_SPECIFIC);
+    void setThisAddress(uint8_t address) { _thisAddress = address; }
+    void setPromiscuous(bool promiscuous) { _promiscuous = promiscuous; }
+
+    // Link model: a packet's last symbol has arrived, false if the radio was not listening since 'lock_ns'
+    bool deliver(const uint8_t *buf, uint8_t len, int16_t rssi, int8_t snr, uint64_t lock_ns);
+    uint8_t spreadingFactor() { return _sf; }
+    long signalBandwidth() { return _bw; }
+    uint32_t frequency() { return _freq; }
+    int8_t txPower() { return _power; }
+
+private:
+    void updateMode();
+
+    RHMode _mode;
+    uint64_t _rxSince;
+    uint64_t _txEnd;
+    bool _crc;
+    uint16_t _preamble;
+    uint8_t _sf;
+    long _bw;
+    uint32_t _freq;
+    int8_t _power;
+
+    uint8_t _buf[RH_RF95_MAX_MESSAGE_LEN + RH_RF95_HEADER_LEN];
+    uint8_t _bufLen;
+    bool _rxBufValid;
+    int16_t _lastRssi;
+    int _lastSNR;
+
+    uint8_t _thisAddress;
+    bool _promiscuous;
+    uint8_t _txHeaderTo, _txHeaderFrom, _txHeaderId, _txHeaderFlags;
+    uint8_t _rxHeaderTo, _rxHeaderFrom, _rxHeaderId, _rxHeaderFlags;
+};
+
+#endif /* __SHIM_RH_RF95_H_ */
@@ -0,0 +1,4 @@
+#ifndef __SHIM_SPI_H_
+#define __SHIM_SPI_H_
+
+#endif /* __SHIM_SPI_H_ */
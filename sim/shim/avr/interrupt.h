@@ -0,0 +1,9 @@
+#ifndef __SHIM_AVR_INTERRUPT_H_
+#define __SHIM_AVR_INTERRUPT_H_
+
+#include "hal.h"
+
+#define sei()   hal_irq_restore(1)
+#define cli()   ((void) hal_irq_save())
+
+#endif /* __SHIM_AVR_INTERRUPT_H_ */
@@ -0,0 +1,40 @@
+#ifndef __SHIM_AVR_IO_H_
+#define __SHIM_AVR_IO_H_
+
+/*
+Just enough of <avr/io.h> to build the controller application (main.c) on
+the host. The ports are plain memory: link_sim reads the LED outputs. The
+buttons go through the host HAL (host_button()).
+*/
+
+#include <stdint.h>
+
+typedef struct {
+    volatile uint8_t DIR;
+    volatile uint8_t OUT;
+    volatile uint8_t IN;
+    volatile uint8_t INTFLAGS;
+    volatile uint8_t PIN0CTRL;
+    volatile uint8_t PIN1CTRL;
+    volatile uint8_t PIN2CTRL;
+    volatile uint8_t PIN3CTRL;
+    volatile uint8_t PIN4CTRL;
+    volatile uint8_t PIN5CTRL;
+    volatile uint8_t PIN6CTRL;
+    volatile uint8_t PIN7CTRL;
+} PORT_t;
+
+extern PORT_t PORTA, PORTC, PORTD, PORTF;
+
+#define PIN0_bm             0x01
+#define PIN1_bm             0x02
+#define PIN2_bm             0x04
+#define PIN3_bm             0x08
+#define PIN4_bm             0x10
+#define PIN5_bm             0x20
+#define PIN6_bm             0x40
+#define PIN7_bm             0x80
+
+#define PORT_PULLUPEN_bm    0x08
+
+#endif /* __SHIM_AVR_IO_H_ */
@@ -0,0 +1,4 @@
+#ifndef __SHIM_AVR_WDT_H_
+#define __SHIM_AVR_WDT_H_
+
+#endif /* __SHIM_AVR_WDT_H_ */
@@ -0,0 +1,8 @@
+#ifndef __SHIM_UTIL_DELAY_H_
+#define __SHIM_UTIL_DELAY_H_
+
+#include "hal.h"
+
+#define _delay_ms(ms)   hal_delay_ms(ms)
+
+#endif /* __SHIM_UTIL_DELAY_H_ */
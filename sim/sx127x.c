@@ -0,0 +1,299 @@
+#include "sx127x.h"
+#include "lora.h"
+#include "toa.h"
+
+#include <string.h>
+
+#define MODE_MASK       0x07
+
+static const struct {
+    uint8_t reg;
+    uint8_t value;
+} reset_values[] = {
+    // Datasheet register table, LoRa mode defaults
+    {REG_OP_MODE, 0x09},
+    {REG_FRF_MSB, 0x6c}, {REG_FRF_MID, 0x80}, {REG_FRF_LSB, 0x00},
+    {REG_PA_CONFIG, 0x4f},
+    {REG_OCP, 0x2b},
+    {REG_LNA, 0x20},
+    {REG_FIFO_ADDR_PTR, 0x00},
+    {REG_FIFO_TX_BASE_ADDR, 0x80},
+    {REG_FIFO_RX_BASE_ADDR, 0x00},
+    {REG_MODEM_CONFIG_1, 0x72},
+    {REG_MODEM_CONFIG_2, 0x70},
+    {REG_PREAMBLE_MSB, 0x00}, {REG_PREAMBLE_LSB, 0x08},
+    {REG_PAYLOAD_LENGTH, 0x01},
+    {REG_MODEM_CONFIG_3, 0x04},
+    {REG_DETECTION_OPTIMIZE, 0xc3},
+    {REG_DETECTION_THRESHOLD, 0x0a},
+    {REG_SYNC_WORD, 0x12},
+    {REG_VERSION, 0x12},
+    {REG_PA_DAC, 0x84},
+};
+
+void sx127x_reset(sx127x_t *radio) {
+    memset(radio->regs, 0, sizeof(radio->regs));
+    for (uint8_t i = 0; i < sizeof(reset_values) / sizeof(reset_values[0]); i++) {
+        radio->regs[reset_values[i].reg] = reset_values[i].value;
+    }
+    radio->selected = 0;
+    radio->tx_active = 0;
+    memset(radio->rx_pending, 0, sizeof(radio->rx_pending));
+}
+
+void sx127x_set_reset_pin(sx127x_t *radio, uint8_t level) {
+    if (radio->reset_pin && !level) {
+        sx127x_reset(radio);
+    }
+    radio->reset_pin = level;
+}
+
+void sx127x_select(sx127x_t *radio, uint8_t selected) {
+    radio->selected = selected;
+    radio->first_byte = selected;
+}
+
+static void toa_config_from_regs(const sx127x_t *radio, toa_config_t *config) {
+    config->sf = radio->regs[REG_MODEM_CONFIG_2] >> 4;
+    config->bandwidth = radio->regs[REG_MODEM_CONFIG_1] >> 4;
+    config->coding_rate = (radio->regs[REG_MODEM_CONFIG_1] >> 1) & 0x07;
+    config->implicit_header = radio->regs[REG_MODEM_CONFIG_1] & 0x01;
+    config->crc = (radio->regs[REG_MODEM_CONFIG_2] >> 2) & 0x01;
+    config->preamble = sx127x_preamble(radio);
+    config->ldro = (radio->regs[REG_MODEM_CONFIG_3] >> 3) & 0x01;
+}
+
+uint32_t sx127x_toa_us(const sx127x_t *radio, uint8_t len) {
+    toa_config_t config;
+    toa_config_from_regs(radio, &config);
+    return toa_packet_us(&config, len);
+}
+
+uint8_t sx127x_sf(const sx127x_t *radio) {
+    return radio->regs[REG_MODEM_CONFIG_2] >> 4;
+}
+
+uint16_t sx127x_preamble(const sx127x_t *radio) {
+    return ((uint16_t) radio->regs[REG_PREAMBLE_MSB] << 8) | radio->regs[REG_PREAMBLE_LSB];
+}
+
+uint32_t sx127x_bw_hz(const sx127x_t *radio) {
+    return TOA_BW_HZ(radio->regs[REG_MODEM_CONFIG_1] >> 4);
+}
+
+uint32_t sx127x_freq_hz(const sx127x_t *radio) {
+    uint32_t frf = ((uint32_t) radio->regs[REG_FRF_MSB] << 16) | ((uint32_t) radio->regs[REG_FRF_MID] << 8)
+                   | radio->regs[REG_FRF_LSB];
+    /* F_XOSC * Frf / 2^19 */
+    return ((uint64_t) frf * 32000000ULL) >> 19;
+}
+
+int8_t sx127x_tx_power(const sx127x_t *radio) {
+    /* PA_BOOST: 2 + OutputPower, 3 dB more with the +20 dBm PA DAC setting */
+    int8_t power = 2 + (radio->regs[REG_PA_CONFIG] & 0x0F);
+    if ((radio->regs[REG_PA_DAC] & 0x07) == 0x07) power += 3;
+    return power;
+}
+
+uint8_t sx127x_mode(const sx127x_t *radio) {
+    return radio->regs[REG_OP_MODE] & MODE_MASK;
+}
+
+static void set_mode(sx127x_t *radio, uint8_t value, uint64_t now_ns) {
+    uint8_t old_mode = sx127x_mode(radio);
+    radio->regs[REG_OP_MODE] = value;
+    uint8_t mode = value & MODE_MASK;
+    if (mode == MODE_TX && old_mode != MODE_TX) {
+        // Transmits RegPayloadLength bytes from RegFifoTxBaseAddr
+        radio->tx_active = 1;
+        radio->tx_start_ns = now_ns;
+        radio->tx_end_ns = now_ns + (uint64_t) sx127x_toa_us(radio, radio->regs[REG_PAYLOAD_LENGTH]) * 1000;
+    } else if (mode != MODE_TX) {
+        radio->tx_active = 0;
+    }
+    // RegRxPacketCnt counts from the transition into receive
+    uint8_t rx = mode == MODE_RX_CONTINUOUS || mode == MODE_RX_SINGLE;
+    if (rx && old_mode != MODE_RX_CONTINUOUS && old_mode != MODE_RX_SINGLE) {
+        radio->regs[REG_RX_PACKET_CNT_MSB] = 0;
+        radio->regs[REG_RX_PACKET_CNT_LSB] = 0;
+    }
+}
+
+static void write_register(sx127x_t *radio, uint8_t addr, uint8_t value, uint64_t now_ns) {
+    switch (addr) {
+        case REG_FIFO:
+            radio->fifo[radio->regs[REG_FIFO_ADDR_PTR]++] = value;
+            break;
+        case REG_OP_MODE:
+            set_mode(radio, value, now_ns);
+            break;
+        case REG_IRQ_FLAGS:
+            radio->regs[REG_IRQ_FLAGS] &= ~value;
+            break;
+        case REG_FRF_MSB:
+        case REG_FRF_MID:
+        case REG_FRF_LSB:
+            // Packets coming in on the old frequency are lost
+            if (radio->regs[addr] != value) memset(radio->rx_pending, 0, sizeof(radio->rx_pending));
+            radio->regs[addr] = value;
+            break;
+        case REG_FIFO_RX_CURRENT_ADDR:
+        case REG_RX_NB_BYTES:
+        case REG_RX_PACKET_CNT_MSB:
+        case REG_RX_PACKET_CNT_LSB:
+        case REG_PKT_SNR_VALUE:
+        case REG_PKT_RSSI_VALUE:
+        case REG_FREQ_ERROR_MSB:
+        case REG_FREQ_ERROR_MID:
+        case REG_FREQ_ERROR_LSB:
+        case REG_RSSI_VALUE:
+        case REG_VERSION:
+            // read only
+            break;
+        default:
+            radio->regs[addr] = value;
+            break;
+    }
+}
+
+static uint8_t read_register(sx127x_t *radio, uint8_t addr, uint64_t now_ns) {
+    if (addr == REG_FIFO) {
+        return radio->fifo[radio->regs[REG_FIFO_ADDR_PTR]++];
+    }
+    uint8_t mode = sx127x_mode(radio);
+    if (addr == REG_RSSI_VALUE && radio->channel_rssi && (mode == MODE_RX_CONTINUOUS || mode == MODE_RX_SINGLE)) {
+        // RSSI = -164 + RssiValue on the LF port
+        int16_t rssi = radio->channel_rssi(radio, now_ns) + RSSI_OFFSET_LF_PORT;
+        return rssi < 0 ? 0 : (rssi > 255 ? 255 : rssi);
+    }
+    return radio->regs[addr];
+}
+
+uint8_t sx127x_transfer(sx127x_t *radio, uint8_t mosi, uint64_t now_ns) {
+    if (!radio->selected || !radio->reset_pin) return 0;
+    if (radio->first_byte) {
+        radio->first_byte = 0;
+        radio->addr = mosi & 0x7f;
+        radio->write = (mosi & 0x80) != 0;
+        return 0;
+    }
+    uint8_t miso = 0;
+    if (radio->write) {
+        write_register(radio, radio->addr, mosi, now_ns);
+    } else {
+        miso = read_register(radio, radio->addr, now_ns);
+    }
+    // Burst access: the address auto-increments, except for the FIFO
+    if (radio->addr != REG_FIFO) {
+        radio->addr = (radio->addr + 1) & 0x7f;
+    }
+    return miso;
+}
+
+static void deliver(sx127x_t *radio, const sx127x_packet_t *packet) {
+    uint8_t mode = sx127x_mode(radio);
+    if (mode != MODE_RX_CONTINUOUS && mode != MODE_RX_SINGLE) {
+        radio->rx_missed++;
+        return;
+    }
+    uint8_t base = radio->regs[REG_FIFO_RX_BASE_ADDR];
+    for (uint16_t i = 0; i < packet->len; i++) {
+        radio->fifo[(uint8_t) (base + i)] = packet->data[i];
+    }
+    radio->regs[REG_FIFO_RX_CURRENT_ADDR] = base;
+    radio->regs[REG_RX_NB_BYTES] = packet->len;
+    radio->regs[REG_PKT_SNR_VALUE] = (uint8_t) (int8_t) (packet->snr * 4);
+    // RSSI = -164 + PacketRssi on the LF port (below 525 MHz)
+    int16_t rssi = packet->rssi + RSSI_OFFSET_LF_PORT;
+    radio->regs[REG_PKT_RSSI_VALUE] = rssi < 0 ? 0 : (rssi > 255 ? 255 : rssi);
+    // Hz = FreqError * 2^24 / F_XOSC * BW / 500 kHz, 20 bit two's complement
+    int32_t fei = (int64_t) packet->freq_error * 244140625 / (256 * (int64_t) sx127x_bw_hz(radio));
+    radio->regs[REG_FREQ_ERROR_MSB] = (fei >> 16) & 0x0F;
+    radio->regs[REG_FREQ_ERROR_MID] = (fei >> 8) & 0xFF;
+    radio->regs[REG_FREQ_ERROR_LSB] = fei & 0xFF;
+    radio->regs[REG_IRQ_FLAGS] |= IRQ_RX_DONE_MASK | (packet->crc_error ? IRQ_PAYLOAD_CRC_ERROR_MASK : 0);
+    if (!packet->crc_error && ++radio->regs[REG_RX_PACKET_CNT_LSB] == 0) radio->regs[REG_RX_PACKET_CNT_MSB]++;
+    if (mode == MODE_RX_SINGLE) {
+        radio->regs[REG_OP_MODE] = (radio->regs[REG_OP_MODE] & ~MODE_MASK) | MODE_STDBY;
+    }
+    radio->rx_packets++;
+}
+
+void sx127x_update(sx127x_t *radio, uint64_t now_ns) {
+    if (radio->tx_active && now_ns >= radio->tx_end_ns) {
+        radio->tx_active = 0;
+        radio->regs[REG_IRQ_FLAGS] |= IRQ_TX_DONE_MASK;
+        // Automatic return to standby after TxDone
+        radio->regs[REG_OP_MODE] = (radio->regs[REG_OP_MODE] & ~MODE_MASK) | MODE_STDBY;
+        radio->tx_packets++;
+        if (radio->on_tx) {
+            uint8_t buf[256];
+            uint8_t len = radio->regs[REG_PAYLOAD_LENGTH];
+            uint8_t base = radio->regs[REG_FIFO_TX_BASE_ADDR];
+            for (uint16_t i = 0; i < len; i++) {
+                buf[i] = radio->fifo[(uint8_t) (base + i)];
+            }
+            radio->on_tx(radio, buf, len, radio->tx_start_ns, radio->tx_end_ns);
+        }
+    }
+    for (uint8_t i = 0; i < SX127X_RX_SLOTS; i++) {
+        if (radio->rx_pending[i] && now_ns >= radio->rx[i].end_ns) {
+            radio->rx_pending[i] = 0;
+            deliver(radio, &radio->rx[i]);
+        }
+    }
+}
+
+uint64_t sx127x_next_event_ns(const sx127x_t *radio) {
+    uint64_t next = UINT64_MAX;
+    if (radio->tx_active) next = radio->tx_end_ns;
+    for (uint8_t i = 0; i < SX127X_RX_SLOTS; i++) {
+        if (radio->rx_pending[i] && radio->rx[i].end_ns < next) next = radio->rx[i].end_ns;
+    }
+    return next;
+}
+
+void sx127x_receive(sx127x_t *radio, const uint8_t *buf, uint8_t len, uint16_t preamble,
+                    int16_t rssi, int8_t snr, int32_t freq_error, uint8_t crc_error, uint64_t now_ns) {
+    /* the air time is the sender's: its preamble, this radio's modem settings */
+    toa_config_t config;
+    toa_config_from_regs(radio, &config);
+    config.preamble = preamble;
+    for (uint8_t i = 0; i < SX127X_RX_SLOTS; i++) {
+        if (radio->rx_pending[i]) continue;
+        sx127x_packet_t *packet = &radio->rx[i];
+        memcpy(packet->data, buf, len);
+        packet->len = len;
+        packet->rssi = rssi;
+        packet->snr = snr;
+        packet->freq_error = freq_error;
+        packet->crc_error = crc_error;
+        packet->end_ns = now_ns + (uint64_t) toa_packet_us(&config, len) * 1000;
+        radio->rx_pending[i] = 1;
+        return;
+    }
+    radio->rx_missed++;
+}
+
+uint8_t sx127x_collide(sx127x_t *radio, uint64_t now_ns) {
+    uint8_t dropped = 0;
+    for (uint8_t i = 0; i < SX127X_RX_SLOTS; i++) {
+        if (radio->rx_pending[i] && radio->rx[i].end_ns > now_ns) {
+            radio->rx_pending[i] = 0;
+            dropped++;
+        }
+    }
+    return dropped;
+}
+
+uint8_t sx127x_dio0(const sx127x_t *radio) {
+    uint8_t flags = radio->regs[REG_IRQ_FLAGS];
+    switch (radio->regs[REG_DIO_MAPPING_1] & 0xc0) {
+        case DIO0_RX_DONE:
+            return (flags & IRQ_RX_DONE_MASK) != 0;
+        case DIO0_TX_DONE:
+            return (flags & IRQ_TX_DONE_MASK) != 0;
+        default:
+            return 0;
+    }
+}
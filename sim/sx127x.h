@@ -0,0 +1,102 @@
+#ifndef __SX127X_H_
+#define __SX127X_H_
+
+/*
+Register-level model of the SX1276/77/78 in LoRa mode
+
+Models what the driver in avr-ble.X/lora.c relies on: the register file
+with reset values, address auto-increment in burst accesses, the 256 byte
+FIFO and its pointers, the op modes, the IRQ flags (write 1 to clear) and
+DIO0 for the RxDone/TxDone mappings. Packets take their real time on air,
+computed from the modem registers with toa.c. RegRssiValue reads what the
+channel_rssi hook says in receive; retuning drops the packets coming in.
+Each packet is written from RegFifoRxBaseAddr and overwrites the length,
+SNR, RSSI and RegFreqError of one not read out yet; RegRxPacketCnt counts
+the good ones since entering receive.
+
+Time is passed in by the caller (the host HAL) in nanoseconds.
+*/
+
+#include <stdint.h>
+
+#define SX127X_RX_SLOTS     4
+
+typedef struct {
+    uint8_t data[256];
+    uint8_t len;
+    int16_t rssi;       // dBm
+    int8_t snr;         // dB
+    int32_t freq_error; // Hz, the sender's carrier above this radio's
+    uint8_t crc_error;
+    uint64_t end_ns;    // last symbol received
+} sx127x_packet_t;
+
+typedef struct sx127x sx127x_t;
+
+// Called when a packet has been fully transmitted
+typedef void (*sx127x_tx_callback)(sx127x_t *radio, const uint8_t *buf, uint8_t len, uint64_t start_ns, uint64_t end_ns);
+
+struct sx127x {
+    uint8_t regs[128];
+    uint8_t fifo[256];
+    uint8_t reset_pin;
+
+    /* SPI transaction state */
+    uint8_t selected;
+    uint8_t first_byte;
+    uint8_t addr;
+    uint8_t write;
+
+    /* packet on air */
+    uint8_t tx_active;
+    uint64_t tx_start_ns;
+    uint64_t tx_end_ns;
+
+    /* packets arriving, delivered to the FIFO when their last symbol is in */
+    sx127x_packet_t rx[SX127X_RX_SLOTS];
+    uint8_t rx_pending[SX127X_RX_SLOTS];
+
+    sx127x_tx_callback on_tx;
+    // Optional: RSSI on the radio's channel at 'now_ns' in dBm, for RegRssiValue in receive
+    int16_t (*channel_rssi)(sx127x_t *radio, uint64_t now_ns);
+    void *user;
+
+    /* statistics */
+    uint32_t tx_packets;
+    uint32_t rx_packets;
+    uint32_t rx_missed; // arrived while not in receive mode or all slots busy
+};
+
+// Power-on / NRESET reset of the register file
+void sx127x_reset(sx127x_t *radio);
+void sx127x_set_reset_pin(sx127x_t *radio, uint8_t level);
+
+// NSS low (selected = 1) starts a transaction, the first byte is the address
+void sx127x_select(sx127x_t *radio, uint8_t selected);
+uint8_t sx127x_transfer(sx127x_t *radio, uint8_t mosi, uint64_t now_ns);
+
+// Finish anything due by 'now_ns' (TxDone, RxDone)
+void sx127x_update(sx127x_t *radio, uint64_t now_ns);
+// Time of the next internal event, UINT64_MAX if none
+uint64_t sx127x_next_event_ns(const sx127x_t *radio);
+
+// Start receiving a packet whose first symbol arrives at 'now_ns', sent with 'preamble' symbols
+// on a carrier 'freq_error' Hz above this radio's
+void sx127x_receive(sx127x_t *radio, const uint8_t *buf, uint8_t len, uint16_t preamble,
+                    int16_t rssi, int8_t snr, int32_t freq_error, uint8_t crc_error, uint64_t now_ns);
+
+// Another packet starts arriving at 'now_ns': drop the ones still coming in. Returns how many
+uint8_t sx127x_collide(sx127x_t *radio, uint64_t now_ns);
+
+uint8_t sx127x_dio0(const sx127x_t *radio);
+uint8_t sx127x_mode(const sx127x_t *radio);
+// Modem setting from the registers
+uint8_t sx127x_sf(const sx127x_t *radio);
+uint32_t sx127x_bw_hz(const sx127x_t *radio);
+uint32_t sx127x_freq_hz(const sx127x_t *radio);
+uint16_t sx127x_preamble(const sx127x_t *radio);
+int8_t sx127x_tx_power(const sx127x_t *radio);
+// Time on air of a 'len' byte packet with the current modem registers
+uint32_t sx127x_toa_us(const sx127x_t *radio, uint8_t len);
+
+#endif /* __SX127X_H_ */
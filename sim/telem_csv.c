@@ -0,0 +1,67 @@
+/*
+Controller telemetry to CSV
+
+Reads what the controller sent on its console, from a serial capture or
+link_sim -t, and prints one CSV line per telemetry record (telem.h). The
+text in between is left out. The receive time and the loss counters go
+on from where they wrapped, so a whole day's log graphs as one.
+
+    ./telem_csv [capture] > records.csv
+*/
+
+#include "telem.h"
+
+#include <stdio.h>
+
+typedef struct {
+    uint32_t last;
+    uint64_t total;
+} unwrap_t;
+
+// Counter that wraps at 'modulus', counting on from its first value in the capture
+static uint64_t unwrap(unwrap_t *u, uint32_t value, uint64_t modulus, uint8_t first) {
+    if (first) u->total = u->last = value;
+    u->total += (value - u->last) & (modulus - 1);
+    u->last = value;
+    return u->total;
+}
+
+int main(int argc, char **argv) {
+    FILE *in = stdin;
+    if (argc > 2) {
+        fprintf(stderr, "usage: %s [capture]\n", argv[0]);
+        return 2;
+    }
+    if (argc == 2 && !(in = fopen(argv[1], "rb"))) {
+        perror(argv[1]);
+        return 2;
+    }
+
+    printf("time_s,pad,op,seq,flags,status,signal_dbm,rssi_dbm,snr_db,freq_error_hz,afc_hz,missed,overflow,crc_errors\n");
+    /* a record is the bytes between two zeros that decode as one, anything else there is text */
+    uint8_t chunk[255];
+    uint16_t len = 0;
+    uint32_t records = 0;
+    unwrap_t at = {0}, missed = {0}, overflow = {0}, crc = {0};
+    int c;
+    while ((c = fgetc(in)) != EOF) {
+        if (c != 0) {
+            if (len < sizeof(chunk)) chunk[len] = c;
+            len++;
+            continue;
+        }
+        telem_rx_t rx;
+        if (len <= sizeof(chunk) && telem_parse_rx(chunk, len, &rx)) {
+            uint8_t first = !records++;
+            printf("%.6f,%u,0x%02x,%u,0x%02x,0x%02x,%d,%d,%d,%ld,%d,%llu,%llu,%llu\n",
+                   unwrap(&at, rx.at, 1ULL << 32, first) / 1e6, rx.from, rx.op, rx.seq, rx.flags, rx.status,
+                   rx.signal, rx.rssi, rx.snr, (long) rx.freq_error, rx.afc,
+                   (unsigned long long) unwrap(&missed, rx.missed, 256, first),
+                   (unsigned long long) unwrap(&overflow, rx.overflow, 256, first),
+                   (unsigned long long) unwrap(&crc, rx.crc_errors, 256, first));
+        }
+        len = 0;
+    }
+    fprintf(stderr, "%u records\n", records);
+    return 0;
+}
@@ -0,0 +1,76 @@
+/*
+Time on air against the datasheet formula
+
+Works out the datasheet's time on air (toa.h) in floating point for every
+spreading factor SF6 to SF12, bandwidth and coding rate, header mode, CRC
+and LowDataRateOptimize setting and a range of lengths and preambles, and
+checks toa_packet_us() and toa_payload_symbols() against it; past
+UINT32_MAX microseconds toa_packet_us() has to stop there. TOA_US(),
+for the CONFIG section of lora.h, has to agree with toa_packet_us() for
+the default settings. Exits with status 1 on any difference.
+*/
+
+#include "toa.h"
+
+#include <math.h>
+#include <stdio.h>
+
+// Bandwidths as the datasheet lists them, by BANDWIDTH_* code
+static const double bandwidth_hz[] = {
+    7.8e3, 10.4e3, 15.6e3, 20.8e3, 31.25e3, 41.7e3, 62.5e3, 125e3, 250e3, 500e3,
+};
+
+static double payload_symbols(const toa_config_t *c, uint8_t len) {
+    double num = 8.0 * len - 4.0 * c->sf + 28 + 16.0 * c->crc - 20.0 * c->implicit_header;
+    double den = 4.0 * (c->sf - 2 * c->ldro);
+    return 8 + fmax(ceil(num / den) * (c->coding_rate + 4), 0);
+}
+
+static double packet_us(const toa_config_t *c, uint8_t len) {
+    double symbol_us = pow(2, c->sf) / bandwidth_hz[c->bandwidth] * 1e6;
+    return (c->preamble + 4.25 + payload_symbols(c, len)) * symbol_us;
+}
+
+int main() {
+    static const uint8_t lens[] = {0, 1, 2, 5, 9, 10, 16, 31, 32, 64, 100, 128, 200, 255};
+    static const uint16_t preambles[] = {6, 8, 12, 100, 1000, 65535};
+    uint32_t cases = 0, failed = 0;
+    toa_config_t c;
+    for (c.sf = 6; c.sf <= 12; c.sf++)
+    for (c.bandwidth = BANDWIDTH_7_8_KHZ; c.bandwidth <= BANDWIDTH_500_KHZ; c.bandwidth++)
+    for (c.coding_rate = CODING_RATE_4_5; c.coding_rate <= CODING_RATE_4_8; c.coding_rate++)
+    for (c.crc = 0; c.crc <= 1; c.crc++)
+    for (c.implicit_header = 0; c.implicit_header <= 1; c.implicit_header++)
+    for (c.ldro = 0; c.ldro <= 1; c.ldro++)
+    for (uint8_t p = 0; p < sizeof(preambles) / sizeof(preambles[0]); p++)
+    for (uint8_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+        c.preamble = preambles[p];
+        uint8_t len = lens[l];
+        double want = fmin(packet_us(&c, len), UINT32_MAX);
+        uint32_t got = toa_packet_us(&c, len);
+        uint16_t symbols = toa_payload_symbols(&c, len);
+        cases++;
+        /* rounded to the microsecond; the bandwidths are exact in both */
+        if (fabs(got - want) > 0.5 + 1e-6 || symbols != payload_symbols(&c, len)) {
+            if (failed++ < 10) {
+                printf("SF%u bw %u cr %u crc %u ih %u ldro %u preamble %u len %u: %u us, %u symbols, "
+                       "datasheet %.2f us, %.0f symbols\n", c.sf, c.bandwidth, c.coding_rate, c.crc,
+                       c.implicit_header, c.ldro, c.preamble, len, got, symbols, want, payload_symbols(&c, len));
+            }
+        }
+    }
+
+    toa_default_config(&c);
+    for (uint16_t len = 0; len <= 255; len++) {
+        cases++;
+        if (TOA_US(len) != toa_packet_us(&c, len)) {
+            if (failed++ < 10) {
+                printf("TOA_US(%u) %lu us, toa_packet_us() %u us\n", len, (unsigned long) TOA_US(len),
+                       toa_packet_us(&c, len));
+            }
+        }
+    }
+
+    printf("toa: %u cases, %u differ from the datasheet formula %s\n", cases, failed, failed ? "FAIL" : "ok");
+    return failed ? 1 : 0;
+}